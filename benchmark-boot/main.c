@@ -1,26 +1,42 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <uk/config.h>
 #include <uk/plat/time.h>
 #include <uk/print.h>
+#include <bench/finish.h>
+#if CONFIG_APPBENCHMARKBOOT_TIMELINE
+#include "timeline.h"
+#endif
 
 static uint64_t boot_start_time = 0;
 
 __attribute__((constructor(101))) // runs early during init
 static void measure_boot_start(void) {
-    boot_start_time = ukplat_monotonic();
-    uk_pr_info("[BOOT TIME] Start timestamp: %llu ns\n", boot_start_time);
+    boot_start_time = ukplat_monotonic_clock();
+#if CONFIG_APPBENCHMARKBOOT_TIMELINE
+    boot_timeline_mark("constructor");
+#endif
+    uk_pr_info("[BOOT TIME] Start timestamp: %" PRIu64 " ns\n", boot_start_time);
 }
 
-int main(int argc, char *argv[]) {
-    uint64_t boot_end_time = ukplat_monotonic();
+int main(void) {
+    uint64_t boot_end_time = ukplat_monotonic_clock();
     uint64_t boot_duration_ns = boot_end_time - boot_start_time;
 
+#if CONFIG_APPBENCHMARKBOOT_TIMELINE
+    boot_timeline_mark("main");
+#endif
+
     uk_pr_info("[BOOT TIME] Reached main()\n");
-    uk_pr_info("[BOOT TIME] Duration: %llu ns (%.3f ms)\n", 
-               boot_duration_ns, boot_duration_ns / 1e6);
+    uk_pr_info("[BOOT TIME] Duration: %" PRIu64 " ns\n", boot_duration_ns);
 
-    // ✅ Clean output for parser
-    uk_pr_info("BOOT_TIME: %.3f\n", boot_duration_ns / 1e6);
+    // ✅ Clean output for parser (nolibc's printf has no %f)
+    printf("BOOT_TIME: %" PRIu64 ".%03" PRIu64 "\n",
+           boot_duration_ns / 1000000, (boot_duration_ns / 1000) % 1000);
 
-    while (1) { } // idle
+#if CONFIG_APPBENCHMARKBOOT_TIMELINE
+    boot_timeline_report();
+#endif
 
-    return 0;
+    bench_finish(BENCH_EXIT_OK);
 }
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <uk/essentials.h>
+#include <uk/ctors.h>
+#include <uk/init.h>
+#include <uk/boot/earlytab.h>
+#include <bench/cycles.h>
+#include "timeline.h"
+
+/*
+ * We cannot wrap the init functions of other libraries, so instead we
+ * register one marker per priority slot of every libukboot table
+ * (earlytab 0-9, ctortab 0-9, inittab class 1-6 x prio 0-9). Each marker
+ * stores the cycle counter and its own function address. When reporting,
+ * we walk the tables in execution order: every function found between two
+ * markers ran inside the segment delimited by their timestamps. This does
+ * not depend on where the linker places our markers within a slot.
+ */
+
+enum tl_table {
+    TL_EARLYTAB,
+    TL_CTORTAB,
+    TL_INITTAB,
+    TL_APP,
+};
+
+struct tl_mark {
+    uint64_t cycles;
+    enum tl_table table;
+    const void *key;
+    const char *label;
+};
+
+#define TL_MAX_MARKS (10 + 10 + 60 + 8)
+
+static struct tl_mark marks[TL_MAX_MARKS];
+static unsigned int nr_marks;
+
+static void tl_mark(enum tl_table table, const void *key, const char *label) {
+    struct tl_mark *m;
+
+    if (nr_marks >= TL_MAX_MARKS)
+        return;
+    m = &marks[nr_marks++];
+    m->cycles = bench_cycles();
+    m->table = table;
+    m->key = key;
+    m->label = label;
+}
+
+#define TL_EARLY_MARK(prio)                                               \
+    static int tl_early_##prio(struct ukplat_bootinfo *bi __unused) {    \
+        tl_mark(TL_EARLYTAB, (const void *)tl_early_##prio,              \
+                "earlytab." #prio);                                       \
+        return 0;                                                         \
+    }                                                                     \
+    UK_BOOT_EARLYTAB_ENTRY(tl_early_##prio, prio)
+
+#define TL_CTOR_MARK(prio)                                                \
+    static void tl_ctor_##prio(void) {                                    \
+        tl_mark(TL_CTORTAB, (const void *)tl_ctor_##prio,                \
+                "ctortab." #prio);                                        \
+    }                                                                     \
+    UK_CTOR_PRIO(tl_ctor_##prio, prio)
+
+#define TL_INIT_MARK(class, prio)                                         \
+    static int tl_init_##class##prio(struct uk_init_ctx *ictx __unused) { \
+        tl_mark(TL_INITTAB, (const void *)tl_init_##class##prio,         \
+                "inittab." #class "." #prio);                             \
+        return 0;                                                         \
+    }                                                                     \
+    uk_initcall_class_prio(tl_init_##class##prio, 0x0, class, prio)
+
+#define TL_EACH_PRIO(m, ...)                                              \
+    m(__VA_ARGS__ 0); m(__VA_ARGS__ 1); m(__VA_ARGS__ 2);                 \
+    m(__VA_ARGS__ 3); m(__VA_ARGS__ 4); m(__VA_ARGS__ 5);                 \
+    m(__VA_ARGS__ 6); m(__VA_ARGS__ 7); m(__VA_ARGS__ 8);                 \
+    m(__VA_ARGS__ 9)
+
+TL_EACH_PRIO(TL_EARLY_MARK);
+TL_EACH_PRIO(TL_CTOR_MARK);
+TL_EACH_PRIO(TL_INIT_MARK, 1,);
+TL_EACH_PRIO(TL_INIT_MARK, 2,);
+TL_EACH_PRIO(TL_INIT_MARK, 3,);
+TL_EACH_PRIO(TL_INIT_MARK, 4,);
+TL_EACH_PRIO(TL_INIT_MARK, 5,);
+TL_EACH_PRIO(TL_INIT_MARK, 6,);
+
+void boot_timeline_mark(const char *label) {
+    tl_mark(TL_APP, NULL, label);
+}
+
+static const struct tl_mark *tl_find(enum tl_table table, const void *key) {
+    for (unsigned int i = 0; i < nr_marks; i++) {
+        if (marks[i].table == table && marks[i].key == key)
+            return &marks[i];
+    }
+    return NULL;
+}
+
+/*
+ * Reporting state: the end of the last printed segment and the foreign
+ * functions seen since then. Empty segments are folded into the next
+ * non-empty one so that the 80 markers don't drown the output.
+ */
+static uint64_t tl_prev;
+static const void *tl_fns[32];
+static unsigned int tl_nr_fns;
+
+static void tl_pending(const void *fn) {
+    if (tl_nr_fns < ARRAY_SIZE(tl_fns))
+        tl_fns[tl_nr_fns] = fn;
+    tl_nr_fns++;
+}
+
+static void tl_emit(const struct tl_mark *m, int force) {
+    if (!tl_nr_fns && !force)
+        return;
+
+    printf("BOOT_PHASE: %s %" PRIu64 " ns (%u fns)\n", m->label,
+           bench_cycles_to_ns(m->cycles - tl_prev), tl_nr_fns);
+    for (unsigned int i = 0; i < tl_nr_fns && i < ARRAY_SIZE(tl_fns); i++)
+        printf("    %p\n", tl_fns[i]);
+
+    tl_prev = m->cycles;
+    tl_nr_fns = 0;
+}
+
+void boot_timeline_report(void) {
+    const struct uk_boot_earlytab_entry *ee;
+    const struct uk_inittab_entry *ie;
+    const uk_ctor_func_t *ce;
+    const struct tl_mark *m, *last = NULL;
+
+    /*
+     * Everything before the first marker ran since vCPU reset (TSC = 0).
+     * The first and last marker of each table are always printed, so the
+     * platform code running between two tables shows up as the first
+     * segment of the following table.
+     */
+    tl_prev = 0;
+    tl_nr_fns = 0;
+
+    for (ee = uk_boot_earlytab_start; ee < &uk_boot_earlytab_end; ee++) {
+        if ((m = tl_find(TL_EARLYTAB, (const void *)ee->init))) {
+            tl_emit(m, !last || m->key == (const void *)tl_early_9);
+            last = m;
+        } else if (ee->init) {
+            tl_pending((const void *)ee->init);
+        }
+    }
+
+    last = NULL;
+    for (ce = uk_ctortab_start; ce < &uk_ctortab_end; ce++) {
+        if ((m = tl_find(TL_CTORTAB, (const void *)*ce))) {
+            tl_emit(m, !last || m->key == (const void *)tl_ctor_9);
+            last = m;
+        } else if (*ce) {
+            tl_pending((const void *)*ce);
+        }
+    }
+
+    last = NULL;
+    for (ie = uk_inittab_start; ie < &uk_inittab_end; ie++) {
+        if ((m = tl_find(TL_INITTAB, (const void *)ie->init))) {
+            tl_emit(m, !last || m->key == (const void *)tl_init_69);
+            last = m;
+        } else if (ie->init) {
+            tl_pending((const void *)ie->init);
+        }
+    }
+
+    // Application marks are recorded in call order
+    for (unsigned int i = 0; i < nr_marks; i++) {
+        if (marks[i].table == TL_APP) {
+            tl_emit(&marks[i], 1);
+            last = &marks[i];
+        }
+    }
+
+    if (last)
+        printf("BOOT_PHASE_TOTAL: %" PRIu64 " ns\n",
+               bench_cycles_to_ns(last->cycles));
+}
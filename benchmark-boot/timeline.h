@@ -0,0 +1,16 @@
+#ifndef BOOT_TIMELINE_H
+#define BOOT_TIMELINE_H
+
+/*
+ * Record an application-level point (e.g. a C constructor or main()) on
+ * the boot timeline. libukboot stages are recorded automatically.
+ */
+void boot_timeline_mark(const char *label);
+
+/*
+ * Print one BOOT_PHASE line per timeline segment together with the
+ * init functions that ran inside it.
+ */
+void boot_timeline_report(void);
+
+#endif /* BOOT_TIMELINE_H */
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/alloc.h>
+#include "malloc_bench.h"
+
+// Allocator state before the workload started
+static __ssz base_avail;
+#if CONFIG_LIBUKALLOC_IFSTATS
+static struct uk_alloc_stats base_stats;
+#endif
+
+void malloc_footprint_begin(void) {
+    struct uk_alloc *a = uk_alloc_get_default();
+
+    base_avail = uk_alloc_availmem(a);
+#if CONFIG_LIBUKALLOC_IFSTATS
+    uk_alloc_stats_get(a, &base_stats);
+#endif
+}
+
+void malloc_snapshot(struct malloc_snapshot *s, const char *phase,
+                     uint64_t requested) {
+    struct uk_alloc *a = uk_alloc_get_default();
+    __ssz avail = uk_alloc_availmem(a);
+#if CONFIG_LIBUKALLOC_IFSTATS
+    struct uk_alloc_stats stats;
+#endif
+
+    s->phase = phase;
+    s->requested = requested;
+    s->free = avail;
+    s->largest = uk_alloc_maxalloc(a);
+#if CONFIG_LIBUKALLOC_IFSTATS
+    // Page allocators account whole pages here, so this is what the heap
+    // really gave out rather than what was asked for
+    uk_alloc_stats_get(a, &stats);
+    s->used = stats.cur_mem_use - base_stats.cur_mem_use;
+    s->live = stats.cur_nb_allocs - base_stats.cur_nb_allocs;
+    s->enomem = stats.nb_enomem - base_stats.nb_enomem;
+#else
+    s->used = (avail >= 0 && base_avail >= 0) ? base_avail - avail : -1;
+    s->live = -1;
+    s->enomem = 0;
+#endif
+}
+
+// x / y as "i.fff", y > 0
+static void print_ratio(const char *key, uint64_t x, uint64_t y) {
+    uint64_t milli = x * 1000 / y;
+
+    printf(" %s=%" PRIu64 ".%03" PRIu64, key, milli / 1000, milli % 1000);
+}
+
+void malloc_snapshot_print(const struct malloc_snapshot *s) {
+    printf("MALLOC_FRAG: %s requested=%" PRIu64, s->phase, s->requested);
+    if (s->used >= 0)
+        printf(" used=%" PRIu64, (uint64_t)s->used);
+    if (s->free >= 0)
+        printf(" free=%" PRIu64, (uint64_t)s->free);
+    if (s->largest >= 0)
+        printf(" largest=%" PRIu64, (uint64_t)s->largest);
+    if (s->live >= 0)
+        printf(" live=%" PRId64, s->live);
+    if (s->enomem)
+        printf(" enomem=%" PRIu64, s->enomem);
+    // Memory the heap handed out per byte requested
+    if (s->used > 0 && s->requested)
+        print_ratio("overhead", s->used, s->requested);
+    // Share of the free memory that cannot be served as one block
+    if (s->free > 0 && s->largest >= 0 && s->largest <= s->free)
+        print_ratio("ext_frag", s->free - s->largest, s->free);
+    printf("\n");
+}
@@ -1,31 +1,137 @@
 #include <stdio.h>
 #include <stdlib.h>
-#include <uk/time.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/essentials.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include "malloc_bench.h"
 
-#define ALLOCS 100000
-#define SIZE 256
+// Set on the kernel command line, e.g. "malloc.allocs=1000 malloc.size=64 --"
+static char *mode = "basic";
+unsigned int malloc_allocs = 100000;
+unsigned int malloc_size = 256;
+unsigned int malloc_seed = 1;
 
-int main(void) {
-    char *buf[ALLOCS];
-    uint64_t start, end;
+UK_LIBPARAM_PARAM(mode, charp, "Workload to run, see modes[]");
+UK_LIBPARAM_PARAM_ALIAS(allocs, &malloc_allocs, uint,
+                        "Number of blocks to allocate");
+UK_LIBPARAM_PARAM_ALIAS(size, &malloc_size, uint,
+                        "Size of each block in bytes");
+UK_LIBPARAM_PARAM_ALIAS(seed, &malloc_seed, uint,
+                        "Seed of the random workloads");
+
+static struct bench_hist malloc_lat;
+static struct bench_hist free_lat;
+
+// Heap backend selected in ukboot, see profiles/alloc/
+#if CONFIG_LIBUKBOOT_INITBBUDDY
+#define MALLOC_BACKEND "bbuddy"
+#elif CONFIG_LIBUKBOOT_INITREGION
+#define MALLOC_BACKEND "region"
+#elif CONFIG_LIBUKBOOT_INITMIMALLOC
+#define MALLOC_BACKEND "mimalloc"
+#elif CONFIG_LIBUKBOOT_INITTLSF
+#define MALLOC_BACKEND "tlsf"
+#elif CONFIG_LIBUKBOOT_INITTINYALLOC
+#define MALLOC_BACKEND "tinyalloc"
+#else
+#define MALLOC_BACKEND "unknown"
+#endif
+
+// Allocate everything, then free in allocation order
+int mode_basic(void) {
+    char **buf;
+    uint64_t start, end, t0, paused;
+    struct malloc_snapshot peak, after;
 
+    buf = calloc(malloc_allocs, sizeof(*buf));
+    if (!buf) {
+        printf("Cannot allocate %u block pointers\n", malloc_allocs);
+        return BENCH_EXIT_FAIL;
+    }
+
+    printf("[MALLOC] allocs=%u size=%u backend=%s\n",
+           malloc_allocs, malloc_size, MALLOC_BACKEND);
+    malloc_footprint_begin();
     start = ukplat_monotonic_clock();
-    for (int i = 0; i < ALLOCS; i++) {
-        buf[i] = malloc(SIZE);
+    for (unsigned int i = 0; i < malloc_allocs; i++) {
+        t0 = bench_cycles();
+        buf[i] = malloc(malloc_size);
+        bench_hist_record(&malloc_lat, bench_cycles() - t0);
         if (!buf[i]) {
-            printf("Allocation failed at %d\n", i);
-            return 1;
+            printf("Allocation failed at %u\n", i);
+            return BENCH_EXIT_FAIL;
         }
         *buf[i] = 'a';
     }
-    for (int i = 0; i < ALLOCS; i++) {
+    // All blocks are live here, so this is the peak of the run
+    paused = ukplat_monotonic_clock();
+    malloc_snapshot(&peak, "peak", (uint64_t)malloc_allocs * malloc_size);
+    start += ukplat_monotonic_clock() - paused;
+    for (unsigned int i = 0; i < malloc_allocs; i++) {
+        t0 = bench_cycles();
         free(buf[i]);
+        bench_hist_record(&free_lat, bench_cycles() - t0);
     }
     end = ukplat_monotonic_clock();
+    malloc_snapshot(&after, "end", 0);
+
+    uint64_t throughput = (uint64_t)malloc_allocs * UKARCH_NSEC_PER_SEC / (end - start);
 
-    double duration = (end - start) / (double)UKPLAT_CLOCK_TICKS_PER_SEC;
-    double throughput = ((double)ALLOCS / duration);
+    printf("MALLOC_OPS: %" PRIu64 "\n", throughput);  // For your parser
+    bench_hist_print(&malloc_lat, "malloc");
+    bench_hist_print(&free_lat, "free");
+    malloc_snapshot_print(&peak);
+    malloc_snapshot_print(&after);
+    // Not every backend can tell how much memory it handed out
+    if (peak.used >= 0)
+        printf("MALLOC_PEAK_KB: %" PRIu64 "\n", (uint64_t)peak.used / 1024);
+    free(buf);
+    return BENCH_EXIT_OK;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(void);
+} modes[] = {
+    { "basic",     mode_basic },
+    { "sweep",     mode_sweep },
+    { "uniform",   mode_uniform },
+    { "lognormal", mode_lognormal },
+    { "hist",      mode_hist },
+    { "fifo",      mode_fifo },
+    { "lifo",      mode_lifo },
+    { "random",    mode_random },
+    { "window",    mode_window },
+    { "churn",     mode_churn },
+    { "threads",   mode_threads },
+    { "prodcons",  mode_prodcons },
+    { "larson",    mode_larson },
+    { "mstress",   mode_mstress },
+    { "xmalloc",   mode_xmalloc },
+    { "scratch",   mode_scratch },
+    { "replay",    mode_replay },
+    { "realloc",   mode_realloc },
+    { "calloc",    mode_calloc },
+    { "memalign",  mode_memalign },
+    { "pages",     mode_pages },
+    { "pages_churn", mode_pages_churn },
+    { "pages_frag", mode_pages_frag },
+    { "soak",      mode_soak },
+};
+
+int main(void) {
+    for (unsigned int i = 0; i < ARRAY_SIZE(modes); i++) {
+        if (!strcmp(mode, modes[i].name)) {
+            printf("[MALLOC] mode=%s\n", mode);
+            bench_finish(modes[i].run());
+        }
+    }
 
-    printf("MALLOC_OPS: %.2f\n", throughput);  // For your parser
-    return 0;
+    printf("Unknown mode: %s\n", mode);
+    bench_finish(BENCH_EXIT_FAIL);
 }
@@ -0,0 +1,101 @@
+#ifndef MALLOC_BENCH_H
+#define MALLOC_BENCH_H
+
+#include <stdint.h>
+#include <uk/thread.h>
+
+// Shared parameters, set on the kernel command line (see main.c)
+extern unsigned int malloc_allocs;
+extern unsigned int malloc_size;
+extern unsigned int malloc_seed;
+// Size range and live-byte cap of the size modes (see sizes.c)
+extern unsigned int malloc_min_size;
+extern unsigned int malloc_max_size;
+extern unsigned int malloc_budget;
+// Thread count and yield interval of the threaded modes (see threads.c)
+extern unsigned int malloc_threads;
+extern unsigned int malloc_batch;
+
+// Power-of-two size classes, class k holds sizes in (2^(k-1), 2^k]
+#define MALLOC_CLASSES 32
+
+static inline unsigned int malloc_class_of(uint32_t sz) {
+    return sz <= 1 ? 0 : 32 - __builtin_clz(sz - 1);
+}
+
+// Checks malloc.min_size/max_size, returns a BENCH_EXIT_* code
+int malloc_check_sizes(void);
+
+// Parses malloc.dist, after which malloc_dist_draw() samples sizes from it
+int malloc_dist_parse(void);
+uint32_t malloc_dist_draw(uint64_t *rng);
+
+/*
+ * Heap state at the end of a workload phase, taken with malloc_snapshot()
+ * and printed later so that printing does not disturb the timing. Values
+ * the allocator cannot provide are -1. With CONFIG_LIBUKALLOC_IFSTATS,
+ * used/live come from uk_alloc's statistics, otherwise used is derived
+ * from the drop in available memory.
+ */
+struct malloc_snapshot {
+    const char *phase;
+    uint64_t requested;   // bytes the workload holds
+    int64_t used;         // bytes the heap handed out for them
+    int64_t free;         // bytes left in the heap
+    int64_t largest;      // largest block that can still be allocated
+    int64_t live;         // live allocations
+    uint64_t enomem;      // failed allocations
+};
+
+// Record the baseline that snapshots are relative to
+void malloc_footprint_begin(void);
+
+void malloc_snapshot(struct malloc_snapshot *s, const char *phase,
+                     uint64_t requested);
+
+/*
+ * MALLOC_FRAG: <phase> requested=.. used=.. free=.. largest=.. live=..
+ *              overhead=<used/requested> ext_frag=<1 - largest/free>
+ */
+void malloc_snapshot_print(const struct malloc_snapshot *s);
+
+/*
+ * Thread helpers for the threaded modes. Threads are uksched threads on the
+ * cooperative scheduler, they only switch in uk_sched_yield(). A thread
+ * started with malloc_thread_start() must end with malloc_thread_done(),
+ * malloc_threads_wait() returns once all of them did.
+ */
+int malloc_thread_start(uk_thread_fn1_t fn, void *arg, const char *name);
+void malloc_thread_done(void) __noreturn;
+void malloc_threads_wait(void);
+
+/*
+ * Workload modes, selected with malloc.mode=<name>. Each returns a
+ * BENCH_EXIT_* code for bench_finish().
+ */
+int mode_basic(void);
+int mode_sweep(void);
+int mode_uniform(void);
+int mode_lognormal(void);
+int mode_hist(void);
+int mode_fifo(void);
+int mode_lifo(void);
+int mode_random(void);
+int mode_window(void);
+int mode_churn(void);
+int mode_threads(void);
+int mode_prodcons(void);
+int mode_larson(void);
+int mode_mstress(void);
+int mode_xmalloc(void);
+int mode_scratch(void);
+int mode_replay(void);
+int mode_realloc(void);
+int mode_calloc(void);
+int mode_memalign(void);
+int mode_pages(void);
+int mode_pages_churn(void);
+int mode_pages_frag(void);
+int mode_soak(void);
+
+#endif /* MALLOC_BENCH_H */
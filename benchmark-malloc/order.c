@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/rand.h>
+#include "malloc_bench.h"
+
+// Number of live blocks in the window and churn modes
+static unsigned int window = 1024;
+// Block sizes are uniform in malloc.size +/- spread percent
+static unsigned int spread = 0;
+
+UK_LIBPARAM_PARAM(window, uint, "Live blocks in window/churn modes");
+UK_LIBPARAM_PARAM(spread, uint, "Block size spread around malloc.size in %");
+
+static struct bench_hist malloc_lat;
+static struct bench_hist free_lat;
+
+// Per-operation inputs, drawn before the clock starts
+static uint32_t *sizes;
+static uint32_t *victims;
+static char **buf;
+static uint64_t rng;
+// Bytes held at the snapshot between the two phases of a mode
+static uint64_t requested;
+static struct malloc_snapshot mid, after;
+
+static inline int timed_malloc(char **p, uint32_t sz) {
+    uint64_t t0 = bench_cycles();
+
+    *p = malloc(sz);
+    bench_hist_record(&malloc_lat, bench_cycles() - t0);
+    if (!*p) {
+        printf("Allocation of %" PRIu32 " bytes failed\n", sz);
+        return BENCH_EXIT_FAIL;
+    }
+    **p = 'a';
+    return BENCH_EXIT_OK;
+}
+
+static inline void timed_free(char *p) {
+    uint64_t t0 = bench_cycles();
+
+    free(p);
+    bench_hist_record(&free_lat, bench_cycles() - t0);
+}
+
+static int setup(unsigned int nbuf) {
+    uint32_t lo, span;
+
+    if (spread > 100) {
+        printf("malloc.spread must be at most 100\n");
+        return BENCH_EXIT_FAIL;
+    }
+    sizes = calloc(malloc_allocs, sizeof(*sizes));
+    victims = calloc(malloc_allocs, sizeof(*victims));
+    buf = calloc(nbuf, sizeof(*buf));
+    if (!sizes || !victims || !buf) {
+        printf("Cannot allocate bookkeeping for %u blocks\n", malloc_allocs);
+        return BENCH_EXIT_FAIL;
+    }
+
+    bench_rand_seed(&rng, malloc_seed);
+    span = (uint64_t)malloc_size * spread / 100;
+    lo = malloc_size - span;
+    for (unsigned int i = 0; i < malloc_allocs; i++) {
+        sizes[i] = lo + bench_rand_below(&rng, 2 * span + 1);
+        if (!sizes[i])
+            sizes[i] = 1;
+    }
+    bench_hist_reset(&malloc_lat);
+    bench_hist_reset(&free_lat);
+    malloc_footprint_begin();
+    return BENCH_EXIT_OK;
+}
+
+// Snapshot between two phases, with the clock stopped meanwhile
+static void snapshot_mid(const char *phase, uint64_t *start) {
+    uint64_t paused = ukplat_monotonic_clock();
+
+    malloc_snapshot(&mid, phase, requested);
+    *start += ukplat_monotonic_clock() - paused;
+}
+
+static uint64_t sum_sizes(unsigned int from, unsigned int to) {
+    uint64_t sum = 0;
+
+    for (unsigned int i = from; i < to; i++)
+        sum += sizes[i];
+    return sum;
+}
+
+static int finish(int ret, uint64_t start, uint64_t end) {
+    if (ret == BENCH_EXIT_OK) {
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               (uint64_t)malloc_allocs * UKARCH_NSEC_PER_SEC / (end - start));
+        bench_hist_print(&malloc_lat, "malloc");
+        bench_hist_print(&free_lat, "free");
+        malloc_snapshot(&after, "end", 0);
+        malloc_snapshot_print(&mid);
+        malloc_snapshot_print(&after);
+    }
+    free(buf);
+    free(victims);
+    free(sizes);
+    return ret;
+}
+
+// Allocate all blocks, then free them oldest first
+int mode_fifo(void) {
+    uint64_t start, end;
+    int ret;
+
+    ret = setup(malloc_allocs);
+    if (ret != BENCH_EXIT_OK)
+        return finish(ret, 0, 0);
+
+    requested = sum_sizes(0, malloc_allocs);
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < malloc_allocs && ret == BENCH_EXIT_OK; i++)
+        ret = timed_malloc(&buf[i], sizes[i]);
+    snapshot_mid("peak", &start);
+    for (unsigned int i = 0; i < malloc_allocs; i++)
+        timed_free(buf[i]);
+    end = ukplat_monotonic_clock();
+    return finish(ret, start, end);
+}
+
+// Allocate all blocks, then free them newest first
+int mode_lifo(void) {
+    uint64_t start, end;
+    int ret;
+
+    ret = setup(malloc_allocs);
+    if (ret != BENCH_EXIT_OK)
+        return finish(ret, 0, 0);
+
+    requested = sum_sizes(0, malloc_allocs);
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < malloc_allocs && ret == BENCH_EXIT_OK; i++)
+        ret = timed_malloc(&buf[i], sizes[i]);
+    snapshot_mid("peak", &start);
+    for (unsigned int i = malloc_allocs; i > 0; i--)
+        timed_free(buf[i - 1]);
+    end = ukplat_monotonic_clock();
+    return finish(ret, start, end);
+}
+
+// Allocate all blocks, then free them in a random permutation
+int mode_random(void) {
+    uint64_t start, end;
+    int ret;
+
+    ret = setup(malloc_allocs);
+    if (ret != BENCH_EXIT_OK)
+        return finish(ret, 0, 0);
+
+    // Fisher-Yates
+    for (unsigned int i = 0; i < malloc_allocs; i++)
+        victims[i] = i;
+    for (unsigned int i = malloc_allocs; i > 1; i--) {
+        uint32_t j = bench_rand_below(&rng, i);
+        uint32_t tmp = victims[i - 1];
+
+        victims[i - 1] = victims[j];
+        victims[j] = tmp;
+    }
+
+    requested = sum_sizes(0, malloc_allocs);
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < malloc_allocs && ret == BENCH_EXIT_OK; i++)
+        ret = timed_malloc(&buf[i], sizes[i]);
+    snapshot_mid("peak", &start);
+    for (unsigned int i = 0; i < malloc_allocs; i++)
+        timed_free(buf[victims[i]]);
+    end = ukplat_monotonic_clock();
+    return finish(ret, start, end);
+}
+
+/*
+ * Keep the last malloc.window blocks alive: every allocation beyond the
+ * window frees the oldest live block first.
+ */
+int mode_window(void) {
+    uint64_t start, end;
+    unsigned int i;
+    int ret;
+
+    if (!window) {
+        printf("malloc.window must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ret = setup(window);
+    if (ret != BENCH_EXIT_OK)
+        return finish(ret, 0, 0);
+
+    requested = sum_sizes(malloc_allocs > window ? malloc_allocs - window : 0,
+                          malloc_allocs);
+    start = ukplat_monotonic_clock();
+    for (i = 0; i < malloc_allocs && ret == BENCH_EXIT_OK; i++) {
+        if (i >= window)
+            timed_free(buf[i % window]);
+        ret = timed_malloc(&buf[i % window], sizes[i]);
+    }
+    snapshot_mid("steady", &start);
+    for (unsigned int j = i > window ? i - window : 0; j < i; j++)
+        timed_free(buf[j % window]);
+    end = ukplat_monotonic_clock();
+    return finish(ret, start, end);
+}
+
+/*
+ * Interleaved alloc/free: malloc.window blocks stay alive and each step
+ * replaces a random one of them. With malloc.spread the new block has a
+ * different size, so holes of all sizes open up all over the heap.
+ */
+int mode_churn(void) {
+    uint64_t start, end;
+    unsigned int i;
+    int ret;
+
+    if (!window || window > malloc_allocs) {
+        printf("malloc.window must be in 1..malloc.allocs\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ret = setup(window);
+    if (ret != BENCH_EXIT_OK)
+        return finish(ret, 0, 0);
+
+    // Draw the victims up front. The first window entries are never used
+    // as victims, so they record which op last fills each slot, which is
+    // what is live at the snapshot.
+    for (i = 0; i < window; i++)
+        victims[i] = i;
+    for (i = window; i < malloc_allocs; i++) {
+        uint32_t slot = bench_rand_below(&rng, window);
+
+        victims[i] = slot;
+        victims[slot] = i;
+    }
+    requested = 0;
+    for (i = 0; i < window; i++)
+        requested += sizes[victims[i]];
+
+    start = ukplat_monotonic_clock();
+    for (i = 0; i < window && ret == BENCH_EXIT_OK; i++)
+        ret = timed_malloc(&buf[i], sizes[i]);
+    for (; i < malloc_allocs && ret == BENCH_EXIT_OK; i++) {
+        timed_free(buf[victims[i]]);
+        ret = timed_malloc(&buf[victims[i]], sizes[i]);
+    }
+    snapshot_mid("steady", &start);
+    for (i = 0; i < window; i++)
+        timed_free(buf[i]);
+    end = ukplat_monotonic_clock();
+    return finish(ret, start, end);
+}
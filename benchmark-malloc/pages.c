@@ -0,0 +1,320 @@
+/*
+ * Page allocator modes: uk_palloc()/uk_pfree() on the default allocator,
+ * bypassing malloc's small-object path. This is the path of stacks,
+ * packet buffers and every malloc() above a page on the ifpages backends.
+ * Blocks are 2^order pages, orders 0 to malloc.max_order.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <uk/alloc.h>
+#include <uk/arch/limits.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/rand.h>
+#include "malloc_bench.h"
+
+// Largest order, bbuddy manages orders 0 to 12 by default
+static unsigned int max_order = 12;
+// Blocks kept live in the pages_churn mode
+static unsigned int page_live = 256;
+// pages_frag keeps one page out of every frag_stride
+static unsigned int frag_stride = 16;
+
+UK_LIBPARAM_PARAM(max_order, uint, "Largest page order");
+UK_LIBPARAM_PARAM(page_live, uint, "Live blocks in pages_churn mode");
+UK_LIBPARAM_PARAM(frag_stride, uint, "pages_frag keeps 1 of this many pages");
+
+#define ORDERS_MAX 20
+// Allocation attempts per order in the fragmented heap
+#define FRAG_TRIES 64
+
+struct page_order {
+    struct bench_hist palloc_lat;
+    struct bench_hist pfree_lat;
+    uint64_t failed;
+    uint64_t ops;        // blocks per second, if measured
+};
+
+static struct page_order *orders;
+static struct uk_alloc *heap;
+
+static int setup(void) {
+    if (max_order >= ORDERS_MAX) {
+        printf("malloc.max_order must be below %u\n", ORDERS_MAX);
+        return BENCH_EXIT_FAIL;
+    }
+    heap = uk_alloc_get_default();
+    orders = calloc(max_order + 1, sizeof(*orders));
+    if (!orders) {
+        printf("Cannot allocate %u page orders\n", max_order + 1);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+static inline void *timed_palloc(unsigned int order) {
+    uint64_t t0 = bench_cycles();
+    void *p = uk_palloc(heap, 1UL << order);
+
+    bench_hist_record(&orders[order].palloc_lat, bench_cycles() - t0);
+    if (!p)
+        orders[order].failed++;
+    else
+        *(volatile char *)p = 'a';
+    return p;
+}
+
+static inline void timed_pfree(void *p, unsigned int order) {
+    uint64_t t0 = bench_cycles();
+
+    uk_pfree(heap, p, 1UL << order);
+    bench_hist_record(&orders[order].pfree_lat, bench_cycles() - t0);
+}
+
+// PALLOC_ORDER: <order> count=.. failed=.. [ops=..] plus histograms
+static void report_orders(void) {
+    char name[32];
+
+    for (unsigned int o = 0; o <= max_order; o++) {
+        struct page_order *c = &orders[o];
+
+        if (!c->palloc_lat.count)
+            continue;
+        printf("PALLOC_ORDER: %u count=%" PRIu64 " failed=%" PRIu64,
+               o, c->palloc_lat.count, c->failed);
+        if (c->ops)
+            printf(" ops=%" PRIu64, c->ops);
+        printf("\n");
+        snprintf(name, sizeof(name), "palloc.%u", o);
+        bench_hist_print(&c->palloc_lat, name);
+        if (c->pfree_lat.count) {
+            snprintf(name, sizeof(name), "pfree.%u", o);
+            bench_hist_print(&c->pfree_lat, name);
+        }
+    }
+}
+
+/*
+ * One order after the other: allocate up to malloc.allocs blocks, bounded
+ * by malloc.budget, then free them all.
+ */
+int mode_pages(void) {
+    struct malloc_snapshot peak;
+    uint64_t start, end, paused;
+    unsigned int i, n;
+    char phase[32];
+    void **buf;
+    int ret;
+
+    ret = setup();
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+    buf = calloc(malloc_allocs, sizeof(*buf));
+    if (!buf) {
+        printf("Cannot allocate %u block pointers\n", malloc_allocs);
+        free(orders);
+        return BENCH_EXIT_FAIL;
+    }
+
+    printf("[MALLOC] pages orders=0..%u\n", max_order);
+    for (unsigned int o = 0; o <= max_order && ret == BENCH_EXIT_OK; o++) {
+        uint64_t bytes = (uint64_t)__PAGE_SIZE << o;
+
+        n = malloc_budget / bytes;
+        if (n > malloc_allocs)
+            n = malloc_allocs;
+        if (!n)
+            n = 1;
+        snprintf(phase, sizeof(phase), "order.%u", o);
+
+        malloc_footprint_begin();
+        start = ukplat_monotonic_clock();
+        for (i = 0; i < n; i++) {
+            buf[i] = timed_palloc(o);
+            if (!buf[i]) {
+                printf("uk_palloc of order %u failed at %u\n", o, i);
+                ret = BENCH_EXIT_FAIL;
+                break;
+            }
+        }
+        paused = ukplat_monotonic_clock();
+        malloc_snapshot(&peak, phase, i * bytes);
+        start += ukplat_monotonic_clock() - paused;
+        for (unsigned int j = 0; j < i; j++)
+            timed_pfree(buf[j], o);
+        end = ukplat_monotonic_clock();
+
+        orders[o].ops = (uint64_t)i * UKARCH_NSEC_PER_SEC / (end - start);
+        malloc_snapshot_print(&peak);
+    }
+    report_orders();
+
+    free(buf);
+    free(orders);
+    return ret;
+}
+
+// Geometric: every order is half as likely as the one below
+static inline unsigned int draw_order(uint64_t *rng) {
+    return __builtin_ctzll(bench_rand(rng) | (1ULL << max_order));
+}
+
+/*
+ * Keep malloc.page_live blocks of mixed orders alive and replace a random
+ * one per step, so that the buddy allocator keeps splitting and merging.
+ * A block that would push the live memory over malloc.budget is
+ * allocated at order 0 instead.
+ */
+int mode_pages_churn(void) {
+    struct malloc_snapshot steady, after;
+    uint64_t start, end, paused, rng, live = 0;
+    unsigned int slot, o;
+    uint8_t *ord;
+    void **buf;
+    int ret;
+
+    if (!page_live) {
+        printf("malloc.page_live must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ret = setup();
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+    buf = calloc(page_live, sizeof(*buf));
+    ord = calloc(page_live, sizeof(*ord));
+    if (!buf || !ord) {
+        printf("Cannot allocate bookkeeping for %u blocks\n", page_live);
+        ret = BENCH_EXIT_FAIL;
+        goto out;
+    }
+
+    printf("[MALLOC] pages_churn live=%u orders=0..%u\n",
+           page_live, max_order);
+    bench_rand_seed(&rng, malloc_seed);
+    malloc_footprint_begin();
+    start = ukplat_monotonic_clock();
+    for (slot = 0; slot < page_live && ret == BENCH_EXIT_OK; slot++) {
+        o = draw_order(&rng);
+        if (live + ((uint64_t)__PAGE_SIZE << o) > malloc_budget)
+            o = 0;
+        buf[slot] = timed_palloc(o);
+        ord[slot] = o;
+        live += (uint64_t)__PAGE_SIZE << o;
+        if (!buf[slot])
+            ret = BENCH_EXIT_FAIL;
+    }
+    for (unsigned int i = 0; i < malloc_allocs && ret == BENCH_EXIT_OK; i++) {
+        slot = bench_rand_below(&rng, page_live);
+        timed_pfree(buf[slot], ord[slot]);
+        live -= (uint64_t)__PAGE_SIZE << ord[slot];
+
+        o = draw_order(&rng);
+        if (live + ((uint64_t)__PAGE_SIZE << o) > malloc_budget)
+            o = 0;
+        buf[slot] = timed_palloc(o);
+        ord[slot] = o;
+        live += (uint64_t)__PAGE_SIZE << o;
+        if (!buf[slot])
+            ret = BENCH_EXIT_FAIL;
+    }
+    paused = ukplat_monotonic_clock();
+    malloc_snapshot(&steady, "steady", live);
+    start += ukplat_monotonic_clock() - paused;
+    for (slot = 0; slot < page_live; slot++)
+        if (buf[slot])
+            timed_pfree(buf[slot], ord[slot]);
+    end = ukplat_monotonic_clock();
+    malloc_snapshot(&after, "end", 0);
+
+    if (ret != BENCH_EXIT_OK) {
+        printf("uk_palloc failed\n");
+    } else {
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               (uint64_t)malloc_allocs * UKARCH_NSEC_PER_SEC / (end - start));
+        report_orders();
+        malloc_snapshot_print(&steady);
+        malloc_snapshot_print(&after);
+    }
+out:
+    free(ord);
+    free(buf);
+    free(orders);
+    return ret;
+}
+
+/*
+ * Fill the whole heap with single pages, then free all but one page of
+ * every malloc.frag_stride. Most of the heap is free afterwards, but no
+ * free run is longer than frag_stride - 1 pages. Then try FRAG_TRIES
+ * blocks per order: the orders that no longer fit show how expensive it
+ * is to fail, the ones that do how long the search takes.
+ */
+int mode_pages_frag(void) {
+    struct malloc_snapshot holed;
+    void **pages, *tries[FRAG_TRIES];
+    unsigned int filled, kept, t;
+    __ssz avail;
+    int ret;
+
+    if (frag_stride < 2) {
+        printf("malloc.frag_stride must be at least 2\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ret = setup();
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+    avail = uk_alloc_availmem(heap);
+    if (avail <= 0) {
+        printf("The allocator does not report its free memory\n");
+        free(orders);
+        return BENCH_EXIT_FAIL;
+    }
+    pages = calloc(avail / __PAGE_SIZE, sizeof(*pages));
+    if (!pages) {
+        printf("Cannot allocate bookkeeping for the heap\n");
+        free(orders);
+        return BENCH_EXIT_FAIL;
+    }
+
+    // The array took some of the heap, so this fills it up completely
+    for (filled = 0; filled < avail / __PAGE_SIZE; filled++) {
+        pages[filled] = uk_palloc(heap, 1);
+        if (!pages[filled])
+            break;
+    }
+    malloc_footprint_begin();
+    kept = 0;
+    for (unsigned int i = 0; i < filled; i++) {
+        if (i % frag_stride) {
+            uk_pfree(heap, pages[i], 1);
+            pages[i] = NULL;
+        } else {
+            kept++;
+        }
+    }
+    printf("[MALLOC] pages_frag pages=%u kept=%u stride=%u\n",
+           filled, kept, frag_stride);
+    malloc_snapshot(&holed, "holed", (uint64_t)kept * __PAGE_SIZE);
+
+    for (unsigned int o = 0; o <= max_order; o++) {
+        for (t = 0; t < FRAG_TRIES; t++)
+            tries[t] = timed_palloc(o);
+        for (t = 0; t < FRAG_TRIES; t++)
+            if (tries[t])
+                timed_pfree(tries[t], o);
+    }
+
+    for (unsigned int i = 0; i < filled; i++)
+        if (pages[i])
+            uk_pfree(heap, pages[i], 1);
+    free(pages);
+
+    report_orders();
+    malloc_snapshot_print(&holed);
+    free(orders);
+    return ret;
+}
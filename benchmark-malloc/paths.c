@@ -0,0 +1,338 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include "malloc_bench.h"
+
+// Blocks grown side by side in the realloc mode
+static unsigned int chains = 8;
+// Growth per realloc step in percent, 100 doubles the block
+static unsigned int growth = 100;
+// Comma-separated alignments of the memalign mode
+static char *aligns = "64,4096,2097152";
+
+UK_LIBPARAM_PARAM(chains, uint, "Blocks grown side by side in realloc mode");
+UK_LIBPARAM_PARAM(growth, uint, "Growth per realloc step in %");
+UK_LIBPARAM_PARAM(aligns, charp, "Alignments of the memalign mode");
+
+#define ALIGNS_MAX 16
+
+// Keeps memset() from being dropped as a dead store before free()
+static volatile char sink;
+
+struct grow_class {
+    struct bench_hist lat;
+    uint64_t moved;
+};
+
+/*
+ * Grow malloc.chains blocks round-robin from malloc.min_size to
+ * malloc.max_size, by malloc.growth percent per step, then free them and
+ * start over until malloc.allocs reallocs are done. Interleaving the
+ * chains keeps a block from simply growing into the free space behind it.
+ * Each realloc is accounted to the class of its new size, moved counts
+ * the ones that returned a different address (and so copied).
+ */
+int mode_realloc(void) {
+    struct grow_class *classes;
+    struct malloc_snapshot peak, after;
+    uint64_t start, end, t0, paused, ops = 0, next;
+    unsigned int rounds = 0, grown;
+    uint32_t *cur;
+    char **blocks, *p;
+    char name[32];
+    int ret = BENCH_EXIT_OK;
+
+    if (malloc_check_sizes() != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    if (malloc_min_size == malloc_max_size || !chains ||
+        (uint64_t)chains * malloc_max_size > malloc_budget) {
+        printf("Need malloc.min_size < malloc.max_size and "
+               "malloc.chains * malloc.max_size <= malloc.budget\n");
+        return BENCH_EXIT_FAIL;
+    }
+    classes = calloc(MALLOC_CLASSES, sizeof(*classes));
+    blocks = calloc(chains, sizeof(*blocks));
+    cur = calloc(chains, sizeof(*cur));
+    if (!classes || !blocks || !cur) {
+        printf("Cannot allocate bookkeeping for %u chains\n", chains);
+        ret = BENCH_EXIT_FAIL;
+        goto out;
+    }
+
+    printf("[MALLOC] realloc chains=%u growth=%u%% sizes=%u..%u\n",
+           chains, growth, malloc_min_size, malloc_max_size);
+    malloc_footprint_begin();
+    start = ukplat_monotonic_clock();
+    do {
+        for (unsigned int i = 0; i < chains && ret == BENCH_EXIT_OK; i++) {
+            blocks[i] = malloc(malloc_min_size);
+            cur[i] = malloc_min_size;
+            if (!blocks[i])
+                ret = BENCH_EXIT_FAIL;
+        }
+        for (grown = 1; grown && ret == BENCH_EXIT_OK;) {
+            grown = 0;
+            for (unsigned int i = 0; i < chains; i++) {
+                struct grow_class *c;
+
+                if (cur[i] >= malloc_max_size)
+                    continue;
+                next = cur[i] + (uint64_t)cur[i] * growth / 100;
+                if (next <= cur[i])
+                    next = cur[i] + 1;
+                if (next > malloc_max_size)
+                    next = malloc_max_size;
+
+                c = &classes[malloc_class_of(next)];
+                t0 = bench_cycles();
+                p = realloc(blocks[i], next);
+                bench_hist_record(&c->lat, bench_cycles() - t0);
+                if (!p) {
+                    printf("realloc to %" PRIu64 " bytes failed\n", next);
+                    ret = BENCH_EXIT_FAIL;
+                    break;
+                }
+                if (p != blocks[i])
+                    c->moved++;
+                p[next - 1] = 'a';
+                blocks[i] = p;
+                cur[i] = next;
+                ops++;
+                grown = 1;
+            }
+        }
+        // Every chain is at malloc.max_size at the end of the first round
+        if (!rounds++ && ret == BENCH_EXIT_OK) {
+            paused = ukplat_monotonic_clock();
+            malloc_snapshot(&peak, "peak", (uint64_t)chains * malloc_max_size);
+            start += ukplat_monotonic_clock() - paused;
+        }
+        for (unsigned int i = 0; i < chains; i++) {
+            free(blocks[i]);
+            blocks[i] = NULL;
+        }
+    } while (ops < malloc_allocs && ret == BENCH_EXIT_OK);
+    end = ukplat_monotonic_clock();
+    malloc_snapshot(&after, "end", 0);
+
+    if (ret == BENCH_EXIT_OK) {
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               ops * UKARCH_NSEC_PER_SEC / (end - start));
+        for (unsigned int k = 0; k < MALLOC_CLASSES; k++) {
+            if (!classes[k].lat.count)
+                continue;
+            printf("MALLOC_REALLOC: %u count=%" PRIu64 " moved=%" PRIu64 "\n",
+                   1u << k, classes[k].lat.count, classes[k].moved);
+            snprintf(name, sizeof(name), "realloc.%u", 1u << k);
+            bench_hist_print(&classes[k].lat, name);
+        }
+        malloc_snapshot_print(&peak);
+        malloc_snapshot_print(&after);
+    }
+out:
+    free(cur);
+    free(blocks);
+    free(classes);
+    return ret;
+}
+
+static struct bench_hist calloc_lat, malloc_lat, memset_lat, free_lat;
+
+static void print_hist(struct bench_hist *h, const char *op, uint32_t key) {
+    char name[32];
+
+    snprintf(name, sizeof(name), "%s.%" PRIu32, op, key);
+    bench_hist_print(h, name);
+}
+
+/*
+ * For every power of two from malloc.min_size to malloc.max_size, compare
+ * calloc() against malloc() followed by memset(), with the zeroing timed on
+ * its own. calloc - malloc is what the allocator pays to zero, memset is
+ * what zeroing costs when done by hand.
+ */
+int mode_calloc(void) {
+    uint64_t t0;
+    char **buf;
+    unsigned int i, n;
+    int ret = BENCH_EXIT_OK;
+
+    if (malloc_check_sizes() != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    buf = calloc(malloc_allocs, sizeof(*buf));
+    if (!buf) {
+        printf("Cannot allocate %u block pointers\n", malloc_allocs);
+        return BENCH_EXIT_FAIL;
+    }
+
+    printf("[MALLOC] calloc sizes=%u..%u\n", malloc_min_size, malloc_max_size);
+    for (unsigned int k = malloc_class_of(malloc_min_size);
+         k <= malloc_class_of(malloc_max_size) && ret == BENCH_EXIT_OK; k++) {
+        uint32_t sz = 1u << k;
+
+        n = malloc_budget / sz;
+        if (n > malloc_allocs)
+            n = malloc_allocs;
+        if (!n)
+            n = 1;
+        bench_hist_reset(&calloc_lat);
+        bench_hist_reset(&malloc_lat);
+        bench_hist_reset(&memset_lat);
+
+        for (i = 0; i < n; i++) {
+            t0 = bench_cycles();
+            buf[i] = calloc(1, sz);
+            bench_hist_record(&calloc_lat, bench_cycles() - t0);
+            if (!buf[i])
+                break;
+        }
+        if (i < n) {
+            printf("calloc() of %" PRIu32 " bytes failed at %u\n", sz, i);
+            ret = BENCH_EXIT_FAIL;
+        }
+        while (i > 0)
+            free(buf[--i]);
+        if (ret != BENCH_EXIT_OK)
+            break;
+
+        for (i = 0; i < n; i++) {
+            t0 = bench_cycles();
+            buf[i] = malloc(sz);
+            bench_hist_record(&malloc_lat, bench_cycles() - t0);
+            if (!buf[i])
+                break;
+            t0 = bench_cycles();
+            memset(buf[i], 0, sz);
+            bench_hist_record(&memset_lat, bench_cycles() - t0);
+            sink += buf[i][sz - 1];
+        }
+        if (i < n) {
+            printf("Allocation of %" PRIu32 " bytes failed at %u\n", sz, i);
+            ret = BENCH_EXIT_FAIL;
+        }
+        while (i > 0)
+            free(buf[--i]);
+
+        // Median cost per block in ns, the histograms have the tails
+        printf("MALLOC_CALLOC: %" PRIu32 " count=%u calloc=%" PRIu64
+               " malloc=%" PRIu64 " memset=%" PRIu64 " ns\n", sz, n,
+               bench_cycles_to_ns(bench_hist_percentile(&calloc_lat, 500)),
+               bench_cycles_to_ns(bench_hist_percentile(&malloc_lat, 500)),
+               bench_cycles_to_ns(bench_hist_percentile(&memset_lat, 500)));
+        print_hist(&calloc_lat, "calloc", sz);
+        print_hist(&malloc_lat, "malloc", sz);
+        print_hist(&memset_lat, "memset", sz);
+    }
+
+    free(buf);
+    return ret;
+}
+
+static int parse_aligns(uint32_t *out, unsigned int *len) {
+    const char *p = aligns;
+    char *end;
+
+    for (*len = 0; *p && *len < ALIGNS_MAX; (*len)++) {
+        out[*len] = strtoul(p, &end, 0);
+        if (out[*len] < sizeof(void *) || (out[*len] & (out[*len] - 1)))
+            break;
+        if (*end != ',' && *end != '\0')
+            break;
+        p = *end ? end + 1 : end;
+    }
+    if (*p || !*len) {
+        printf("Invalid alignments: %s\n", aligns);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+/*
+ * posix_memalign() blocks of malloc.size bytes at each of malloc.aligns.
+ * The snapshot with all blocks live shows the padding the allocator spends
+ * on the alignment as overhead, e.g. uk_alloc's page-based path reserves
+ * size + align bytes and rounds that up to pages.
+ */
+int mode_memalign(void) {
+    uint32_t align[ALIGNS_MAX];
+    unsigned int len, i, n;
+    uint64_t start, end, t0, paused;
+    struct malloc_snapshot peak;
+    char phase[32];
+    char **buf;
+    int ret, err;
+
+    if (!malloc_size) {
+        printf("malloc.size must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ret = parse_aligns(align, &len);
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+    buf = calloc(malloc_allocs, sizeof(*buf));
+    if (!buf) {
+        printf("Cannot allocate %u block pointers\n", malloc_allocs);
+        return BENCH_EXIT_FAIL;
+    }
+
+    printf("[MALLOC] memalign size=%u aligns=%s\n", malloc_size, aligns);
+    for (unsigned int a = 0; a < len && ret == BENCH_EXIT_OK; a++) {
+        // Worst case every block takes size + align bytes
+        n = malloc_budget / ((uint64_t)malloc_size + align[a]);
+        if (n > malloc_allocs)
+            n = malloc_allocs;
+        if (!n)
+            n = 1;
+        bench_hist_reset(&malloc_lat);
+        bench_hist_reset(&free_lat);
+        snprintf(phase, sizeof(phase), "align.%" PRIu32, align[a]);
+
+        malloc_footprint_begin();
+        start = ukplat_monotonic_clock();
+        for (i = 0; i < n; i++) {
+            t0 = bench_cycles();
+            err = posix_memalign((void **)&buf[i], align[a], malloc_size);
+            bench_hist_record(&malloc_lat, bench_cycles() - t0);
+            if (err) {
+                printf("posix_memalign(%" PRIu32 ", %u) failed at %u: %d\n",
+                       align[a], malloc_size, i, err);
+                ret = BENCH_EXIT_FAIL;
+                break;
+            }
+            if ((uintptr_t)buf[i] & (align[a] - 1)) {
+                printf("posix_memalign(%" PRIu32 ") returned %p\n",
+                       align[a], buf[i]);
+                ret = BENCH_EXIT_FAIL;
+                i++;
+                break;
+            }
+            *buf[i] = 'a';
+        }
+        paused = ukplat_monotonic_clock();
+        malloc_snapshot(&peak, phase, (uint64_t)i * malloc_size);
+        start += ukplat_monotonic_clock() - paused;
+        for (unsigned int j = 0; j < i; j++) {
+            t0 = bench_cycles();
+            free(buf[j]);
+            bench_hist_record(&free_lat, bench_cycles() - t0);
+        }
+        end = ukplat_monotonic_clock();
+        if (ret != BENCH_EXIT_OK)
+            break;
+
+        printf("MALLOC_ALIGN: %" PRIu32 " count=%u ops=%" PRIu64 "\n",
+               align[a], n, (uint64_t)n * UKARCH_NSEC_PER_SEC / (end - start));
+        print_hist(&malloc_lat, "memalign", align[a]);
+        print_hist(&free_lat, "free", align[a]);
+        malloc_snapshot_print(&peak);
+    }
+
+    free(buf);
+    return ret;
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/essentials.h>
+#include <uk/plat/memory.h>
+#include <uk/plat/time.h>
+#include <bench/alloc_trace.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include "malloc_bench.h"
+
+static const char *const op_names[] = {
+    [ALLOC_TRACE_MALLOC]   = "malloc",
+    [ALLOC_TRACE_FREE]     = "free",
+    [ALLOC_TRACE_CALLOC]   = "calloc",
+    [ALLOC_TRACE_REALLOC]  = "realloc",
+    [ALLOC_TRACE_MEMALIGN] = "memalign",
+};
+
+static struct bench_hist op_lat[ARRAY_SIZE(op_names)];
+
+// Live block and its requested size per trace id
+static char **blocks;
+static uint32_t *sizes;
+
+/*
+ * The trace is passed as the initrd (qemu -initrd, kraft run --initrd) and
+ * used in place, without a filesystem.
+ */
+static int load_trace(const struct alloc_trace_header **hdr,
+                      const struct alloc_trace_rec **recs) {
+    struct ukplat_memregion_desc *mrd;
+    const struct alloc_trace_header *h;
+    uint64_t len;
+
+    if (ukplat_memregion_find_initrd0(&mrd) < 0) {
+        printf("No trace found, pass one as the initrd\n");
+        return BENCH_EXIT_FAIL;
+    }
+    h = (const void *)(mrd->vbase + mrd->pg_off);
+    len = mrd->len;
+    if (len < sizeof(*h) || h->magic != ALLOC_TRACE_MAGIC ||
+        h->version != ALLOC_TRACE_VERSION) {
+        printf("The initrd is not an allocation trace\n");
+        return BENCH_EXIT_FAIL;
+    }
+    if (!h->count) {
+        printf("The trace is empty\n");
+        return BENCH_EXIT_FAIL;
+    }
+    if (h->count > (len - sizeof(*h)) / sizeof(**recs)) {
+        printf("Trace truncated: %" PRIu64 " records, %" PRIu64 " bytes\n",
+               h->count, len);
+        return BENCH_EXIT_FAIL;
+    }
+    *hdr = h;
+    *recs = (const void *)(h + 1);
+    return BENCH_EXIT_OK;
+}
+
+static int replay_one(const struct alloc_trace_rec *r, uint64_t i) {
+    char **p = &blocks[r->id];
+    char *old = *p;
+    // Zero-sized blocks may be NULL here, but the id must stay live
+    size_t sz = r->size ? r->size : 1;
+    uint64_t t0;
+
+    // Freeing a live id and allocating a free one is all a valid trace does
+    if ((r->op == ALLOC_TRACE_FREE || r->op == ALLOC_TRACE_REALLOC) != !!old) {
+        printf("Record %" PRIu64 ": bad %s of id %" PRIu32 "\n",
+               i, op_names[r->op], r->id);
+        return BENCH_EXIT_FAIL;
+    }
+
+    t0 = bench_cycles();
+    switch (r->op) {
+    case ALLOC_TRACE_MALLOC:
+        *p = malloc(sz);
+        break;
+    case ALLOC_TRACE_FREE:
+        free(old);
+        *p = NULL;
+        break;
+    case ALLOC_TRACE_CALLOC:
+        *p = calloc(1, sz);
+        break;
+    case ALLOC_TRACE_REALLOC:
+        *p = realloc(old, sz);
+        break;
+    case ALLOC_TRACE_MEMALIGN:
+        // glibc accepts smaller alignments than uk_alloc, which wants a
+        // multiple of the pointer size
+        *p = memalign(MAX((size_t)1 << r->align_log2, sizeof(void *)), sz);
+        break;
+    }
+    bench_hist_record(&op_lat[r->op], bench_cycles() - t0);
+
+    if (r->op == ALLOC_TRACE_FREE)
+        return BENCH_EXIT_OK;
+    if (!*p) {
+        printf("Record %" PRIu64 ": %s of %" PRIu32 " bytes failed\n",
+               i, op_names[r->op], r->size);
+        // realloc() keeps the old block on failure
+        *p = old;
+        return BENCH_EXIT_FAIL;
+    }
+    **p = 'a';
+    return BENCH_EXIT_OK;
+}
+
+/*
+ * Replay an allocation trace recorded on the host as fast as possible,
+ * ignoring the recorded timing except for reporting it.
+ */
+int mode_replay(void) {
+    const struct alloc_trace_header *hdr;
+    const struct alloc_trace_rec *recs, *r;
+    uint64_t start, end, trace_ns = 0, live = 0, peak_live = 0, i;
+    struct malloc_snapshot after;
+    int ret;
+
+    ret = load_trace(&hdr, &recs);
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+
+    // Validate up front, so that the replay loop does not need to
+    for (i = 0; i < hdr->count; i++) {
+        r = &recs[i];
+        if (r->id >= hdr->ids || !r->op || r->op >= ARRAY_SIZE(op_names) ||
+            (r->op == ALLOC_TRACE_MEMALIGN && r->align_log2 >= 32)) {
+            printf("Record %" PRIu64 " is invalid\n", i);
+            return BENCH_EXIT_FAIL;
+        }
+        trace_ns += r->delta_ns;
+    }
+
+    blocks = calloc(hdr->ids, sizeof(*blocks));
+    sizes = calloc(hdr->ids, sizeof(*sizes));
+    if (!blocks || !sizes) {
+        printf("Cannot allocate bookkeeping for %" PRIu32 " ids\n", hdr->ids);
+        free(blocks);
+        free(sizes);
+        return BENCH_EXIT_FAIL;
+    }
+    for (i = 0; i < ARRAY_SIZE(op_lat); i++)
+        bench_hist_reset(&op_lat[i]);
+
+    printf("[MALLOC] replay records=%" PRIu64 " ids=%" PRIu32 "\n",
+           hdr->count, hdr->ids);
+    malloc_footprint_begin();
+    start = ukplat_monotonic_clock();
+    for (i = 0; i < hdr->count && ret == BENCH_EXIT_OK; i++) {
+        r = &recs[i];
+        ret = replay_one(r, i);
+        // Bytes the trace holds, at the peak they are all still live
+        live -= sizes[r->id];
+        sizes[r->id] = r->op == ALLOC_TRACE_FREE ? 0 : r->size;
+        live += sizes[r->id];
+        if (live > peak_live)
+            peak_live = live;
+    }
+    end = ukplat_monotonic_clock();
+    // What the traced program still held when it exited
+    malloc_snapshot(&after, "end", live);
+
+    if (ret == BENCH_EXIT_OK) {
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               hdr->count * UKARCH_NSEC_PER_SEC / (end - start));
+        printf("MALLOC_TRACE: records=%" PRIu64 " trace_ns=%" PRIu64
+               " replay_ns=%" PRIu64 " peak_requested=%" PRIu64 "\n",
+               hdr->count, trace_ns, end - start, peak_live);
+        for (i = 0; i < ARRAY_SIZE(op_lat); i++)
+            if (op_lat[i].count)
+                bench_hist_print(&op_lat[i], op_names[i]);
+        malloc_snapshot_print(&after);
+    }
+
+    for (i = 0; i < hdr->ids; i++)
+        free(blocks[i]);
+    free(blocks);
+    free(sizes);
+    return ret;
+}
@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/rand.h>
+#include "malloc_bench.h"
+
+// Size range of the sweep and random modes
+unsigned int malloc_min_size = 8;
+unsigned int malloc_max_size = 1024 * 1024;
+// Live bytes are capped so that large classes fit into small guests
+unsigned int malloc_budget = 32 * 1024 * 1024;
+// Log-normal mode: median is malloc.size, sigma in hundredths
+static unsigned int sigma = 100;
+// Histogram mode: comma-separated "<size>:<weight>" pairs
+static char *dist = "16:40,64:30,256:15,1024:10,65536:5";
+
+UK_LIBPARAM_PARAM_ALIAS(min_size, &malloc_min_size, uint,
+                        "Smallest block size");
+UK_LIBPARAM_PARAM_ALIAS(max_size, &malloc_max_size, uint,
+                        "Largest block size");
+UK_LIBPARAM_PARAM_ALIAS(budget, &malloc_budget, uint,
+                        "Maximum live bytes at any time");
+UK_LIBPARAM_PARAM(sigma, uint, "Log-normal sigma * 100");
+UK_LIBPARAM_PARAM(dist, charp, "Size histogram, \"size:weight,...\"");
+
+#define DIST_MAX 32
+
+// Power-of-two size class, block sizes in (2^(k-1), 2^k]
+struct size_class {
+    struct bench_hist malloc_lat;
+    struct bench_hist free_lat;
+};
+
+static struct size_class *classes;
+
+/*
+ * Allocate the blocks in order and free them in allocation order whenever
+ * the next one would exceed the budget (and once at the end). Returns the
+ * wall-clock time in *ns, without the heap snapshot taken at the end of
+ * the first (largest) round.
+ */
+static int run_sizes(const uint32_t *sizes, unsigned int n, char **buf,
+                     uint64_t *ns, struct malloc_snapshot *peak,
+                     const char *phase) {
+    unsigned int i = 0, j, k;
+    uint64_t live, t0, start, paused;
+    struct size_class *c;
+
+    malloc_footprint_begin();
+    start = ukplat_monotonic_clock();
+    while (i < n) {
+        live = 0;
+        for (j = i;
+             j < n && (j == i || live + sizes[j] <= malloc_budget); j++) {
+            c = &classes[malloc_class_of(sizes[j])];
+            t0 = bench_cycles();
+            buf[j] = malloc(sizes[j]);
+            bench_hist_record(&c->malloc_lat, bench_cycles() - t0);
+            if (!buf[j]) {
+                printf("Allocation of %" PRIu32 " bytes failed at %u\n",
+                       sizes[j], j);
+                return BENCH_EXIT_FAIL;
+            }
+            *buf[j] = 'a';
+            live += sizes[j];
+        }
+        if (!i) {
+            paused = ukplat_monotonic_clock();
+            malloc_snapshot(peak, phase, live);
+            start += ukplat_monotonic_clock() - paused;
+        }
+        for (k = i; k < j; k++) {
+            c = &classes[malloc_class_of(sizes[k])];
+            t0 = bench_cycles();
+            free(buf[k]);
+            bench_hist_record(&c->free_lat, bench_cycles() - t0);
+        }
+        i = j;
+    }
+    *ns = ukplat_monotonic_clock() - start;
+    return BENCH_EXIT_OK;
+}
+
+/*
+ * One MALLOC_CLASS line plus malloc/free histograms per class. ops are
+ * malloc+free pairs per second, from wall-clock time if given, otherwise
+ * from the time spent inside the allocator.
+ */
+static void report_class(unsigned int k, uint64_t wall_ns) {
+    struct size_class *c = &classes[k];
+    uint64_t count = c->malloc_lat.count;
+    uint64_t ns;
+    char name[32];
+
+    if (!count)
+        return;
+    ns = wall_ns ? wall_ns
+                 : bench_cycles_to_ns(c->malloc_lat.sum + c->free_lat.sum);
+    printf("MALLOC_CLASS: %u count=%" PRIu64 " ops=%" PRIu64 "\n",
+           1u << k, count, ns ? count * UKARCH_NSEC_PER_SEC / ns : 0);
+    snprintf(name, sizeof(name), "malloc.%u", 1u << k);
+    bench_hist_print(&c->malloc_lat, name);
+    snprintf(name, sizeof(name), "free.%u", 1u << k);
+    bench_hist_print(&c->free_lat, name);
+}
+
+int malloc_check_sizes(void) {
+    if (!malloc_min_size || malloc_min_size > malloc_max_size ||
+        malloc_max_size > 1u << (MALLOC_CLASSES - 1)) {
+        printf("Invalid size range %u..%u\n", malloc_min_size, malloc_max_size);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+static int setup(uint32_t **sizes, char ***buf, unsigned int n) {
+    if (malloc_check_sizes() != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    classes = calloc(MALLOC_CLASSES, sizeof(*classes));
+    *sizes = calloc(n, sizeof(**sizes));
+    *buf = calloc(n, sizeof(**buf));
+    if (!classes || !*sizes || !*buf) {
+        printf("Cannot allocate bookkeeping for %u blocks\n", n);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+static void teardown(uint32_t *sizes, char **buf) {
+    free(buf);
+    free(sizes);
+    free(classes);
+    classes = NULL;
+}
+
+// Powers of two from min_size to max_size, each class timed on its own
+int mode_sweep(void) {
+    uint32_t *sizes;
+    char **buf;
+    uint64_t ns;
+    struct malloc_snapshot peak, after;
+    char phase[32], phase_end[32];
+    int ret;
+
+    ret = setup(&sizes, &buf, malloc_allocs);
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+
+    for (unsigned int k = malloc_class_of(malloc_min_size);
+         k <= malloc_class_of(malloc_max_size); k++) {
+        uint32_t sz = 1u << k;
+        unsigned int n = malloc_budget / sz;
+
+        if (n > malloc_allocs)
+            n = malloc_allocs;
+        if (!n)
+            n = 1;
+        for (unsigned int i = 0; i < n; i++)
+            sizes[i] = sz;
+
+        snprintf(phase, sizeof(phase), "sweep.%" PRIu32, sz);
+        ret = run_sizes(sizes, n, buf, &ns, &peak, phase);
+        if (ret != BENCH_EXIT_OK)
+            break;
+        snprintf(phase_end, sizeof(phase_end), "%s.end", phase);
+        malloc_snapshot(&after, phase_end, 0);
+        report_class(k, ns);
+        malloc_snapshot_print(&peak);
+        malloc_snapshot_print(&after);
+    }
+
+    teardown(sizes, buf);
+    return ret;
+}
+
+// Sizes are drawn up front so the generator stays out of the timed loop
+static int run_random(uint32_t (*draw)(uint64_t *rng)) {
+    uint32_t *sizes;
+    char **buf;
+    uint64_t rng, ns;
+    struct malloc_snapshot peak, after;
+    int ret;
+
+    ret = setup(&sizes, &buf, malloc_allocs);
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+
+    bench_rand_seed(&rng, malloc_seed);
+    for (unsigned int i = 0; i < malloc_allocs; i++) {
+        uint32_t sz = draw(&rng);
+
+        if (sz < malloc_min_size)
+            sz = malloc_min_size;
+        if (sz > malloc_max_size)
+            sz = malloc_max_size;
+        sizes[i] = sz;
+    }
+
+    ret = run_sizes(sizes, malloc_allocs, buf, &ns, &peak, "peak");
+    if (ret == BENCH_EXIT_OK) {
+        malloc_snapshot(&after, "end", 0);
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               (uint64_t)malloc_allocs * UKARCH_NSEC_PER_SEC / ns);
+        for (unsigned int k = 0; k < MALLOC_CLASSES; k++)
+            report_class(k, 0);
+        malloc_snapshot_print(&peak);
+        malloc_snapshot_print(&after);
+    }
+
+    teardown(sizes, buf);
+    return ret;
+}
+
+static uint32_t draw_uniform(uint64_t *rng) {
+    return malloc_min_size +
+           bench_rand_below(rng, malloc_max_size - malloc_min_size + 1);
+}
+
+int mode_uniform(void) {
+    return run_random(draw_uniform);
+}
+
+// 2^(i/16) in Q16, interpolated linearly in between
+static const uint32_t exp2_frac[17] = {
+    65536, 68438, 71468, 74632, 77936, 81386, 84990, 88752, 92682,
+    96785, 101070, 105545, 110218, 115098, 120194, 125515, 131072,
+};
+
+/*
+ * size * exp(sigma * z) in integer arithmetic, the build has no FPU
+ * support. z ~ N(0, 1) comes from the sum of 12 uniforms (Irwin-Hall),
+ * all exponents are in Q12.
+ */
+static uint32_t draw_lognormal(uint64_t *rng) {
+    int64_t z = -6 * 4096, e;
+    uint64_t v, f;
+
+    for (int i = 0; i < 12; i++)
+        z += bench_rand_below(rng, 4096);
+    // Natural to base-2 exponent, log2(e) ~= 5909 / 4096
+    e = z * (int64_t)sigma / 100 * 5909 / 4096;
+
+    f = e & 4095;
+    v = exp2_frac[f >> 8] +
+        ((exp2_frac[(f >> 8) + 1] - exp2_frac[f >> 8]) * (f & 255) >> 8);
+    v = (uint64_t)malloc_size * v >> 16;
+    e >>= 12;
+    if (e >= 32)
+        return UINT32_MAX;
+    if (e <= -32)
+        return 0;
+    v = e >= 0 ? v << e : v >> -e;
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+int mode_lognormal(void) {
+    return run_random(draw_lognormal);
+}
+
+static uint32_t dist_size[DIST_MAX];
+static uint32_t dist_cumul[DIST_MAX];
+static unsigned int dist_len;
+
+uint32_t malloc_dist_draw(uint64_t *rng) {
+    uint32_t r = bench_rand_below(rng, dist_cumul[dist_len - 1]);
+    unsigned int i = 0;
+
+    while (r >= dist_cumul[i])
+        i++;
+    return dist_size[i];
+}
+
+int malloc_dist_parse(void) {
+    const char *p = dist;
+    uint32_t total = 0;
+    char *end;
+
+    for (dist_len = 0; *p && dist_len < DIST_MAX; dist_len++) {
+        dist_size[dist_len] = strtoul(p, &end, 0);
+        if (*end != ':')
+            break;
+        total += strtoul(end + 1, &end, 0);
+        dist_cumul[dist_len] = total;
+        if (*end != ',' && *end != '\0')
+            break;
+        p = *end ? end + 1 : end;
+    }
+    if (*p || !dist_len || !total) {
+        printf("Invalid size histogram: %s\n", dist);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+int mode_hist(void) {
+    if (malloc_dist_parse() != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    return run_random(malloc_dist_draw);
+}
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <uk/plat/time.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/rand.h>
+#include "malloc_bench.h"
+
+// Run time and report interval of the soak mode, in seconds
+static unsigned int duration = 60;
+static unsigned int interval = 10;
+// Blocks kept live during the soak
+static unsigned int soak_live = 4096;
+
+UK_LIBPARAM_PARAM(duration, uint, "Soak run time in seconds");
+UK_LIBPARAM_PARAM(interval, uint, "Soak report interval in seconds");
+UK_LIBPARAM_PARAM(soak_live, uint, "Live blocks during the soak");
+
+// Steps between two looks at the clock
+#define SOAK_CHECK  256
+// One step in this many is a realloc instead of a free and malloc
+#define SOAK_REALLOC 16
+
+static struct bench_hist malloc_lat, free_lat, realloc_lat;
+static struct bench_hist total_malloc, total_free;
+
+// First and latest interval, for the drift summary
+struct soak_interval {
+    uint64_t ops;
+    uint64_t p99;
+    int64_t used;
+};
+
+// " key=+x.y%" for the change from first to last, first > 0
+static void print_change(const char *key, uint64_t first, uint64_t last) {
+    uint64_t diff = last > first ? last - first : first - last;
+    uint64_t permille = diff * 1000 / first;
+
+    printf(" %s=%c%" PRIu64 ".%" PRIu64 "%%", key,
+           last < first && permille ? '-' : '+', permille / 10, permille % 10);
+}
+
+/*
+ * Replace random blocks of a live set with new ones drawn from malloc.dist,
+ * with a realloc every SOAK_REALLOC steps, for malloc.duration seconds.
+ * Every malloc.interval seconds it prints throughput, p99 and a heap
+ * snapshot of that interval, so slow drift, leaks and creeping
+ * fragmentation show up as trends:
+ *
+ *   MALLOC_SOAK: t=<s> ops=<ops/s> malloc_p99=<ns> free_p99=<ns>
+ *   MALLOC_FRAG: soak.<s> requested=.. used=.. ...
+ */
+int mode_soak(void) {
+    struct soak_interval first = { 0 }, last = { 0 };
+    struct malloc_snapshot snap;
+    uint64_t now, start, deadline, next, begin;
+    uint64_t rng, live = 0, ops = 0, step = 0;
+    uint32_t *sizes;
+    char **buf, *p;
+    char phase[32];
+    unsigned int slot, n = 0;
+    uint32_t sz;
+    uint64_t t0;
+    int ret = BENCH_EXIT_OK;
+
+    if (!duration || !interval || !soak_live) {
+        printf("malloc.duration, malloc.interval and malloc.soak_live "
+               "must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    if (malloc_dist_parse() != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    buf = calloc(soak_live, sizeof(*buf));
+    sizes = calloc(soak_live, sizeof(*sizes));
+    if (!buf || !sizes) {
+        printf("Cannot allocate bookkeeping for %u blocks\n", soak_live);
+        ret = BENCH_EXIT_FAIL;
+        goto out;
+    }
+
+    printf("[MALLOC] soak duration=%us interval=%us live=%u\n",
+           duration, interval, soak_live);
+    bench_rand_seed(&rng, malloc_seed);
+    malloc_footprint_begin();
+    for (slot = 0; slot < soak_live; slot++) {
+        sizes[slot] = malloc_dist_draw(&rng);
+        buf[slot] = malloc(sizes[slot]);
+        if (!buf[slot] && sizes[slot]) {
+            printf("Allocation of %" PRIu32 " bytes failed\n", sizes[slot]);
+            ret = BENCH_EXIT_FAIL;
+            goto out;
+        }
+        live += sizes[slot];
+    }
+
+    begin = start = ukplat_monotonic_clock();
+    deadline = begin + (uint64_t)duration * UKARCH_NSEC_PER_SEC;
+    next = begin + (uint64_t)interval * UKARCH_NSEC_PER_SEC;
+    for (;;) {
+        slot = bench_rand_below(&rng, soak_live);
+        sz = malloc_dist_draw(&rng);
+        if (++step % SOAK_REALLOC) {
+            t0 = bench_cycles();
+            free(buf[slot]);
+            bench_hist_record(&free_lat, bench_cycles() - t0);
+            buf[slot] = NULL;
+            t0 = bench_cycles();
+            p = malloc(sz);
+            bench_hist_record(&malloc_lat, bench_cycles() - t0);
+        } else {
+            t0 = bench_cycles();
+            p = realloc(buf[slot], sz);
+            bench_hist_record(&realloc_lat, bench_cycles() - t0);
+        }
+        // A failed realloc() leaves the old block in place
+        if (!p && sz) {
+            printf("Allocation of %" PRIu32 " bytes failed\n", sz);
+            ret = BENCH_EXIT_FAIL;
+            break;
+        }
+        if (sz)
+            *p = 'a';
+        buf[slot] = p;
+        live += sz - (uint64_t)sizes[slot];
+        sizes[slot] = sz;
+        ops++;
+
+        if (step % SOAK_CHECK)
+            continue;
+        now = ukplat_monotonic_clock();
+        if (now < next && now < deadline)
+            continue;
+
+        // End of an interval, the report is not part of the next one
+        n++;
+        snprintf(phase, sizeof(phase), "soak.%" PRIu64,
+                 (now - begin) / UKARCH_NSEC_PER_SEC);
+        malloc_snapshot(&snap, phase, live);
+        last.ops = ops * UKARCH_NSEC_PER_SEC / (now - start);
+        last.p99 = bench_cycles_to_ns(bench_hist_percentile(&malloc_lat, 990));
+        last.used = snap.used;
+        if (n == 1)
+            first = last;
+        printf("MALLOC_SOAK: t=%" PRIu64 " ops=%" PRIu64
+               " malloc_p99=%" PRIu64 " free_p99=%" PRIu64 "\n",
+               (now - begin) / UKARCH_NSEC_PER_SEC, last.ops, last.p99,
+               bench_cycles_to_ns(bench_hist_percentile(&free_lat, 990)));
+        malloc_snapshot_print(&snap);
+
+        bench_hist_merge(&total_malloc, &malloc_lat);
+        bench_hist_merge(&total_free, &free_lat);
+        bench_hist_reset(&malloc_lat);
+        bench_hist_reset(&free_lat);
+        ops = 0;
+        if (now >= deadline)
+            break;
+        next += (uint64_t)interval * UKARCH_NSEC_PER_SEC;
+        start = ukplat_monotonic_clock();
+    }
+
+    if (ret == BENCH_EXIT_OK) {
+        bench_hist_print(&total_malloc, "malloc");
+        bench_hist_print(&total_free, "free");
+        if (realloc_lat.count)
+            bench_hist_print(&realloc_lat, "realloc");
+        // Last interval against the first one
+        printf("MALLOC_SOAK_DRIFT: intervals=%u", n);
+        if (first.ops)
+            print_change("ops", first.ops, last.ops);
+        if (first.p99)
+            print_change("malloc_p99", first.p99, last.p99);
+        if (first.used > 0 && last.used >= 0)
+            print_change("used", first.used, last.used);
+        printf("\n");
+    }
+out:
+    for (slot = 0; buf && slot < soak_live; slot++)
+        free(buf[slot]);
+    free(sizes);
+    free(buf);
+    return ret;
+}
@@ -0,0 +1,448 @@
+/*
+ * Ports of classic allocator stress benchmarks, using the parameters they
+ * are usually run with in allocator comparisons (e.g. mimalloc-bench):
+ *
+ *   larson        server simulation, random replacement of live blocks by
+ *                 short-lived threads that inherit their predecessor's blocks
+ *   mstress       mixed small/large allocations with blocks migrating
+ *                 between threads through a shared transfer array
+ *   xmalloc       writers allocate, readers free whole batches
+ *   cache-scratch each thread frees a block from the main thread and then
+ *                 repeatedly allocates, writes and frees small objects
+ *
+ * All run on malloc.threads uksched threads and report MALLOC_OPS plus
+ * malloc/free histograms, like the other modes.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <uk/plat/time.h>
+#include <uk/sched.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/rand.h>
+#include "malloc_bench.h"
+
+#define LARSON_MIN      8
+#define LARSON_MAX      1000
+#define LARSON_SLOTS    1000
+#define LARSON_ROUNDS   10
+
+#define MSTRESS_SLOTS     256
+#define MSTRESS_TRANSFER  1000
+
+#define XMALLOC_MAX     120
+#define XMALLOC_BATCH   4096
+
+#define SCRATCH_SIZE    8
+#define SCRATCH_WRITES  1000
+
+// Threads are cooperative, so one set of histograms serves all of them
+static struct bench_hist malloc_lat;
+static struct bench_hist free_lat;
+static volatile uint64_t total_ops;
+static volatile int failed;
+
+static inline void *timed_malloc(size_t sz) {
+    uint64_t t0 = bench_cycles();
+    void *p = malloc(sz);
+
+    bench_hist_record(&malloc_lat, bench_cycles() - t0);
+    if (!p)
+        failed = 1;
+    return p;
+}
+
+static inline void timed_free(void *p) {
+    uint64_t t0 = bench_cycles();
+
+    free(p);
+    bench_hist_record(&free_lat, bench_cycles() - t0);
+}
+
+static int stress_begin(const char *name) {
+    if (!malloc_threads || !malloc_batch) {
+        printf("malloc.threads and malloc.batch must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    bench_hist_reset(&malloc_lat);
+    bench_hist_reset(&free_lat);
+    total_ops = 0;
+    failed = 0;
+    printf("[MALLOC] %s threads=%u allocs=%u\n",
+           name, malloc_threads, malloc_allocs);
+    return BENCH_EXIT_OK;
+}
+
+static int stress_end(uint64_t start) {
+    uint64_t end = ukplat_monotonic_clock();
+
+    if (failed) {
+        printf("Allocation failed\n");
+        return BENCH_EXIT_FAIL;
+    }
+    printf("MALLOC_OPS: %" PRIu64 "\n",
+           total_ops * UKARCH_NSEC_PER_SEC / (end - start));
+    bench_hist_print(&malloc_lat, "malloc");
+    bench_hist_print(&free_lat, "free");
+    return BENCH_EXIT_OK;
+}
+
+// Starts fn for every element of args[], an array of threads elements
+static int start_all(uk_thread_fn1_t fn, void *args, size_t argsize,
+                     const char *prefix) {
+    char name[32];
+
+    for (unsigned int i = 0; i < malloc_threads; i++) {
+        snprintf(name, sizeof(name), "%s-%u", prefix, i);
+        if (malloc_thread_start(fn, (char *)args + i * argsize, name) !=
+            BENCH_EXIT_OK) {
+            failed = 1;
+            return BENCH_EXIT_FAIL;
+        }
+    }
+    return BENCH_EXIT_OK;
+}
+
+/* larson */
+
+struct larson {
+    void **blocks;
+    uint64_t rng;
+    unsigned int round;
+};
+
+static inline size_t larson_size(uint64_t *rng) {
+    return LARSON_MIN + bench_rand_below(rng, LARSON_MAX - LARSON_MIN + 1);
+}
+
+static __noreturn void larson_thread(void *arg) {
+    struct larson *l = arg;
+    unsigned int ops = malloc_allocs / LARSON_ROUNDS;
+
+    for (unsigned int i = 0; i < ops && !failed; i++) {
+        unsigned int victim = bench_rand_below(&l->rng, LARSON_SLOTS);
+
+        timed_free(l->blocks[victim]);
+        l->blocks[victim] = timed_malloc(larson_size(&l->rng));
+        if (!(i % malloc_batch))
+            uk_sched_yield();
+    }
+    total_ops += ops;
+
+    // Hand the blocks over to a fresh thread, which frees what we allocated
+    if (++l->round < LARSON_ROUNDS && !failed)
+        if (malloc_thread_start(larson_thread, l, "larson") != BENCH_EXIT_OK)
+            failed = 1;
+    malloc_thread_done();
+}
+
+int mode_larson(void) {
+    struct larson *l;
+    uint64_t start;
+    int ret;
+
+    if (stress_begin("larson") != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    l = calloc(malloc_threads, sizeof(*l));
+    if (!l)
+        return BENCH_EXIT_FAIL;
+
+    // Fill every thread's slots before the clock starts
+    for (unsigned int i = 0; i < malloc_threads && !failed; i++) {
+        l[i].blocks = calloc(LARSON_SLOTS, sizeof(*l[i].blocks));
+        if (!l[i].blocks) {
+            failed = 1;
+            break;
+        }
+        bench_rand_seed(&l[i].rng, malloc_seed + i);
+        for (unsigned int j = 0; j < LARSON_SLOTS; j++) {
+            l[i].blocks[j] = malloc(larson_size(&l[i].rng));
+            if (!l[i].blocks[j])
+                failed = 1;
+        }
+    }
+
+    start = ukplat_monotonic_clock();
+    if (!failed)
+        start_all(larson_thread, l, sizeof(*l), "larson");
+    malloc_threads_wait();
+    ret = stress_end(start);
+
+    for (unsigned int i = 0; i < malloc_threads; i++) {
+        for (unsigned int j = 0; l[i].blocks && j < LARSON_SLOTS; j++)
+            free(l[i].blocks[j]);
+        free(l[i].blocks);
+    }
+    free(l);
+    return ret;
+}
+
+/* mstress */
+
+struct mstress {
+    void *slots[MSTRESS_SLOTS];
+    uint64_t rng;
+};
+
+static void *transfer[MSTRESS_TRANSFER];
+
+// Mostly small blocks, every 100th one up to 40 times malloc.size
+static inline size_t mstress_size(uint64_t *rng) {
+    size_t sz = 1 + bench_rand_below(rng, malloc_size);
+
+    if (!bench_rand_below(rng, 100))
+        sz *= 1 + bench_rand_below(rng, 40);
+    return sz;
+}
+
+static __noreturn void mstress_thread(void *arg) {
+    struct mstress *m = arg;
+    unsigned int slot, r;
+    void *p;
+
+    for (unsigned int i = 0; i < malloc_allocs && !failed; i++) {
+        r = bench_rand_below(&m->rng, 100);
+        slot = bench_rand_below(&m->rng, MSTRESS_SLOTS);
+        if (r < 40) {
+            // Replace a local block
+            timed_free(m->slots[slot]);
+            m->slots[slot] = timed_malloc(mstress_size(&m->rng));
+        } else if (r < 70) {
+            timed_free(m->slots[slot]);
+            m->slots[slot] = NULL;
+        } else if (r < 85) {
+            // Swap with the transfer array, blocks end up on other threads
+            unsigned int t = bench_rand_below(&m->rng, MSTRESS_TRANSFER);
+
+            p = transfer[t];
+            transfer[t] = m->slots[slot];
+            m->slots[slot] = p;
+        } else {
+            // Short-lived temporary
+            size_t sz = mstress_size(&m->rng);
+
+            p = timed_malloc(sz);
+            if (p)
+                memset(p, 0, sz);
+            timed_free(p);
+        }
+        if (!(i % malloc_batch))
+            uk_sched_yield();
+    }
+    total_ops += malloc_allocs;
+
+    for (slot = 0; slot < MSTRESS_SLOTS; slot++)
+        timed_free(m->slots[slot]);
+    malloc_thread_done();
+}
+
+int mode_mstress(void) {
+    struct mstress *m;
+    uint64_t start;
+    int ret;
+
+    if (!malloc_size) {
+        printf("malloc.size must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    if (stress_begin("mstress") != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    m = calloc(malloc_threads, sizeof(*m));
+    if (!m)
+        return BENCH_EXIT_FAIL;
+
+    memset(transfer, 0, sizeof(transfer));
+    for (unsigned int i = 0; i < malloc_threads; i++)
+        bench_rand_seed(&m[i].rng, malloc_seed + i);
+
+    start = ukplat_monotonic_clock();
+    if (!failed)
+        start_all(mstress_thread, m, sizeof(*m), "mstress");
+    malloc_threads_wait();
+    ret = stress_end(start);
+
+    for (unsigned int i = 0; i < MSTRESS_TRANSFER; i++)
+        free(transfer[i]);
+    free(m);
+    return ret;
+}
+
+/* xmalloc-test */
+
+struct xbatch {
+    struct xbatch *next;
+    unsigned int n;
+    void *blocks[XMALLOC_BATCH];
+};
+
+static struct xbatch *xfull;
+static volatile unsigned int writing;
+
+struct xworker {
+    uint64_t rng;
+};
+
+// malloc.allocs blocks in batches of XMALLOC_BATCH, the last one partial
+static __noreturn void xmalloc_writer(void *arg) {
+    struct xworker *x = arg;
+    struct xbatch *b;
+    unsigned int n;
+    void *p;
+
+    for (unsigned int left = malloc_allocs; left && !failed; left -= n) {
+        n = left < XMALLOC_BATCH ? left : XMALLOC_BATCH;
+        b = malloc(sizeof(*b));
+        if (!b) {
+            failed = 1;
+            break;
+        }
+        for (b->n = 0; b->n < n; b->n++) {
+            p = timed_malloc(1 + bench_rand_below(&x->rng, XMALLOC_MAX));
+            if (!p)
+                break;
+            b->blocks[b->n] = p;
+            if (!(b->n % malloc_batch))
+                uk_sched_yield();
+        }
+        // Queued even if cut short, so that the reader frees its blocks
+        b->next = xfull;
+        xfull = b;
+        total_ops += b->n;
+    }
+    writing--;
+    malloc_thread_done();
+}
+
+static __noreturn void xmalloc_reader(void *arg) {
+    struct xbatch *b;
+
+    (void)arg;
+    while (writing || xfull) {
+        b = xfull;
+        if (!b) {
+            uk_sched_yield();
+            continue;
+        }
+        xfull = b->next;
+        for (unsigned int i = 0; i < b->n; i++) {
+            timed_free(b->blocks[i]);
+            if (!(i % malloc_batch))
+                uk_sched_yield();
+        }
+        free(b);
+    }
+    malloc_thread_done();
+}
+
+int mode_xmalloc(void) {
+    struct xworker *x;
+    unsigned int writers = (malloc_threads + 1) / 2;
+    uint64_t start;
+    char name[32];
+    int ret;
+
+    if (stress_begin("xmalloc") != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    x = calloc(writers, sizeof(*x));
+    if (!x)
+        return BENCH_EXIT_FAIL;
+
+    xfull = NULL;
+    writing = writers;
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < malloc_threads && !failed; i++) {
+        snprintf(name, sizeof(name), "xmalloc-%u", i);
+        if (i < writers) {
+            bench_rand_seed(&x[i].rng, malloc_seed + i);
+            failed = malloc_thread_start(xmalloc_writer, &x[i],
+                                         name) != BENCH_EXIT_OK;
+            if (failed)
+                writing -= writers - i;
+        } else {
+            failed = malloc_thread_start(xmalloc_reader, NULL,
+                                         name) != BENCH_EXIT_OK;
+        }
+    }
+    // With a single thread there is no reader, free the batches here
+    if (malloc_threads < 2 && !failed) {
+        malloc_threads_wait();
+        if (malloc_thread_start(xmalloc_reader, NULL, "xmalloc-r") ==
+            BENCH_EXIT_OK)
+            malloc_threads_wait();
+    }
+    malloc_threads_wait();
+    ret = stress_end(start);
+
+    // Left behind if a reader could not be started
+    while (xfull) {
+        struct xbatch *b = xfull;
+
+        xfull = b->next;
+        for (unsigned int i = 0; i < b->n; i++)
+            free(b->blocks[i]);
+        free(b);
+    }
+    free(x);
+    return ret;
+}
+
+/* cache-scratch */
+
+struct scratch {
+    char *initial;
+};
+
+static __noreturn void scratch_thread(void *arg) {
+    struct scratch *s = arg;
+    volatile char *p;
+
+    // Free the block the main thread allocated next to the others' blocks
+    timed_free(s->initial);
+    s->initial = NULL;
+    for (unsigned int i = 0; i < malloc_allocs && !failed; i++) {
+        p = timed_malloc(SCRATCH_SIZE);
+        if (!p)
+            break;
+        for (unsigned int j = 0; j < SCRATCH_WRITES; j++)
+            p[j % SCRATCH_SIZE]++;
+        timed_free((void *)p);
+        if (!(i % malloc_batch))
+            uk_sched_yield();
+    }
+    total_ops += malloc_allocs;
+    malloc_thread_done();
+}
+
+int mode_scratch(void) {
+    struct scratch *s;
+    uint64_t start;
+    int ret;
+
+    if (stress_begin("cache-scratch") != BENCH_EXIT_OK)
+        return BENCH_EXIT_FAIL;
+    s = calloc(malloc_threads, sizeof(*s));
+    if (!s)
+        return BENCH_EXIT_FAIL;
+
+    // Allocated back to back, so that they likely share cache lines
+    for (unsigned int i = 0; i < malloc_threads; i++) {
+        s[i].initial = malloc(SCRATCH_SIZE);
+        if (!s[i].initial)
+            failed = 1;
+    }
+
+    start = ukplat_monotonic_clock();
+    if (!failed)
+        start_all(scratch_thread, s, sizeof(*s), "scratch");
+    malloc_threads_wait();
+    ret = stress_end(start);
+
+    // Blocks of threads that were never started
+    for (unsigned int i = 0; i < malloc_threads; i++)
+        free(s[i].initial);
+    free(s);
+    return ret;
+}
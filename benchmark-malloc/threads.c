@@ -0,0 +1,252 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <uk/plat/lcpu.h>
+#include <uk/plat/time.h>
+#include <uk/sched.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include "malloc_bench.h"
+
+// Worker threads, each doing malloc.allocs operations
+unsigned int malloc_threads = 4;
+// Operations between two yields, so that the threads interleave
+unsigned int malloc_batch = 64;
+// Capacity of the producer/consumer queue in blocks
+static unsigned int queue = 1024;
+
+UK_LIBPARAM_PARAM_ALIAS(threads, &malloc_threads, uint,
+                        "Number of worker threads");
+UK_LIBPARAM_PARAM_ALIAS(batch, &malloc_batch, uint,
+                        "Operations between two yields");
+UK_LIBPARAM_PARAM(queue, uint, "Producer/consumer queue length");
+
+struct worker {
+    unsigned int id;
+    uint64_t ops;
+    int ret;
+    struct bench_hist malloc_lat;
+    struct bench_hist free_lat;
+};
+
+static struct worker *workers;
+static volatile unsigned int running;
+
+int malloc_thread_start(uk_thread_fn1_t fn, void *arg, const char *name) {
+    if (!uk_sched_thread_create(uk_sched_current(), fn, arg, name)) {
+        printf("Cannot create thread %s\n", name);
+        return BENCH_EXIT_FAIL;
+    }
+    running++;
+    return BENCH_EXIT_OK;
+}
+
+void malloc_thread_done(void) {
+    running--;
+    uk_sched_thread_exit();
+}
+
+void malloc_threads_wait(void) {
+    while (running)
+        uk_sched_yield();
+}
+
+/*
+ * Blocks handed from producers to consumers. ukschedcoop switches threads
+ * only in uk_sched_yield(), so the queue needs no locking.
+ */
+static char **ring;
+static volatile uint64_t head, tail;
+static volatile unsigned int producing;
+// Set when not every thread could be started, producers then stop early
+static volatile int aborted;
+
+static int alloc_one(struct worker *w, char **p) {
+    uint64_t t0 = bench_cycles();
+
+    *p = malloc(malloc_size);
+    bench_hist_record(&w->malloc_lat, bench_cycles() - t0);
+    if (!*p) {
+        printf("Thread %u: allocation failed\n", w->id);
+        return BENCH_EXIT_FAIL;
+    }
+    **p = 'a';
+    return BENCH_EXIT_OK;
+}
+
+static void free_one(struct worker *w, char *p) {
+    uint64_t t0 = bench_cycles();
+
+    free(p);
+    bench_hist_record(&w->free_lat, bench_cycles() - t0);
+}
+
+// Allocate a batch, free it again and let the next thread run
+static __noreturn void local_worker(void *arg) {
+    struct worker *w = arg;
+    char **blocks = calloc(malloc_batch, sizeof(*blocks));
+    unsigned int n, got;
+
+    if (!blocks)
+        w->ret = BENCH_EXIT_FAIL;
+    while (w->ops < malloc_allocs && w->ret == BENCH_EXIT_OK) {
+        n = malloc_allocs - w->ops;
+        if (n > malloc_batch)
+            n = malloc_batch;
+        for (got = 0; got < n; got++) {
+            w->ret = alloc_one(w, &blocks[got]);
+            if (w->ret != BENCH_EXIT_OK)
+                break;
+        }
+        for (unsigned int i = 0; i < got; i++)
+            free_one(w, blocks[i]);
+        w->ops += got;
+        uk_sched_yield();
+    }
+    free(blocks);
+    malloc_thread_done();
+}
+
+static __noreturn void producer(void *arg) {
+    struct worker *w = arg;
+    char *p;
+
+    while (w->ops < malloc_allocs && w->ret == BENCH_EXIT_OK && !aborted) {
+        for (unsigned int i = 0;
+             i < malloc_batch && w->ops < malloc_allocs; i++) {
+            // A full queue that no consumer drains would never empty
+            while (head - tail == queue && !aborted)
+                uk_sched_yield();
+            if (aborted)
+                break;
+            w->ret = alloc_one(w, &p);
+            if (w->ret != BENCH_EXIT_OK)
+                break;
+            ring[head % queue] = p;
+            head++;
+            w->ops++;
+        }
+        uk_sched_yield();
+    }
+    producing--;
+    malloc_thread_done();
+}
+
+// Frees blocks that another thread allocated
+static __noreturn void consumer(void *arg) {
+    struct worker *w = arg;
+
+    for (;;) {
+        for (unsigned int i = 0; i < malloc_batch && tail != head; i++) {
+            free_one(w, ring[tail % queue]);
+            tail++;
+            w->ops++;
+        }
+        if (tail == head && !producing)
+            break;
+        uk_sched_yield();
+    }
+    malloc_thread_done();
+}
+
+/*
+ * Run malloc.threads threads, the last n2 of them with fn2 instead of fn,
+ * and wait for all of them to finish.
+ */
+static int run_threads(uk_thread_fn1_t fn, uk_thread_fn1_t fn2,
+                       unsigned int n2) {
+    uint64_t start, end, total = 0;
+    int ret = BENCH_EXIT_OK;
+    char name[32];
+
+    if (!malloc_threads || !malloc_batch) {
+        printf("malloc.threads and malloc.batch must not be 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    workers = calloc(malloc_threads, sizeof(*workers));
+    if (!workers) {
+        printf("Cannot allocate %u workers\n", malloc_threads);
+        return BENCH_EXIT_FAIL;
+    }
+    for (unsigned int i = 0; i < malloc_threads; i++)
+        workers[i].ret = BENCH_EXIT_OK;
+    aborted = 0;
+
+    printf("[MALLOC] threads=%u vcpus=%" PRIu32 " batch=%u\n",
+           malloc_threads, (uint32_t)ukplat_lcpu_count(), malloc_batch);
+
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < malloc_threads; i++) {
+        workers[i].id = i;
+        snprintf(name, sizeof(name), "malloc-%u", i);
+        ret = malloc_thread_start(i < malloc_threads - n2 ? fn : fn2,
+                                  &workers[i], name);
+        if (ret != BENCH_EXIT_OK) {
+            // Producers that never ran must not keep the consumers waiting,
+            // and those that run must not wait for consumers that never do
+            producing -= i < malloc_threads - n2 ? malloc_threads - n2 - i : 0;
+            aborted = 1;
+            break;
+        }
+    }
+    // Let the threads that exist finish before tearing down
+    malloc_threads_wait();
+    end = ukplat_monotonic_clock();
+
+    for (unsigned int i = 0; i < malloc_threads; i++) {
+        struct worker *w = &workers[i];
+
+        if (w->ret != BENCH_EXIT_OK)
+            ret = w->ret;
+        // Consumers only free, count what was allocated
+        if (i < malloc_threads - n2)
+            total += w->ops;
+        printf("MALLOC_THREAD: %u ops=%" PRIu64 "\n", i, w->ops);
+        snprintf(name, sizeof(name), "malloc.t%u", i);
+        if (w->malloc_lat.count)
+            bench_hist_print(&w->malloc_lat, name);
+        snprintf(name, sizeof(name), "free.t%u", i);
+        if (w->free_lat.count)
+            bench_hist_print(&w->free_lat, name);
+    }
+    if (ret == BENCH_EXIT_OK)
+        printf("MALLOC_OPS: %" PRIu64 "\n",
+               total * UKARCH_NSEC_PER_SEC / (end - start));
+
+    free(workers);
+    return ret;
+}
+
+/*
+ * Every thread allocates and frees its own blocks. ukschedcoop runs all
+ * threads on the boot CPU, so with more vCPUs this shows the cost of
+ * interleaving rather than parallel scaling.
+ */
+int mode_threads(void) {
+    return run_threads(local_worker, NULL, 0);
+}
+
+// Half of the threads allocate, the other half free the blocks
+int mode_prodcons(void) {
+    unsigned int consumers = malloc_threads / 2;
+    int ret;
+
+    if (malloc_threads < 2 || !queue) {
+        printf("prodcons needs malloc.threads >= 2 and malloc.queue > 0\n");
+        return BENCH_EXIT_FAIL;
+    }
+    ring = calloc(queue, sizeof(*ring));
+    if (!ring)
+        return BENCH_EXIT_FAIL;
+    head = tail = 0;
+    producing = malloc_threads - consumers;
+
+    ret = run_threads(producer, consumer, consumers);
+    // Left over if the consumers did not all start
+    while (tail != head)
+        free(ring[tail++ % queue]);
+    free(ring);
+    return ret;
+}
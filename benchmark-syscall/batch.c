@@ -0,0 +1,364 @@
+/*
+ * Batched submission: n I/O operations issued one system call at a time,
+ * through a submission/completion ring entered once per batch, and as
+ * one vectored call where the kernel has one.
+ *
+ * Unikraft has no io_uring. The ring here has its shape, a submission
+ * queue the application fills and a completion queue it reaps, but
+ * entering it is a plain function call and ring_enter() always drains it
+ * through the shim handlers. It is compared with the call way: with the
+ * shim a system call is a function call too, so the ring shows whether
+ * saving n - 1 entries pays for its bookkeeping. It never pays a trap, so
+ * it says nothing about what batching would save a trapping binary.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <uk/essentials.h>
+#include <uk/libparam.h>
+#include <uk/plat/time.h>
+#include <uk/syscall.h>
+#include <bench/finish.h>
+#include "syscall_bench.h"
+
+// Largest batch, the vectors are sized for it
+#define BATCH_MAX 256
+// An operation takes up to two ring entries
+#define RING_ENTRIES (2 * BATCH_MAX)
+
+#define FILE_PATH "/syscall-batch.dat"
+
+// Batches of 1, 2, 4 ... syscall.batch_max operations
+static unsigned int batch_max = BATCH_MAX;
+
+UK_LIBPARAM_PARAM(batch_max, uint, "Largest batch of the batch mode");
+
+enum batch_op {
+    BATCH_PREAD,
+    BATCH_PWRITE,
+    BATCH_SEND,
+    BATCH_RECV,
+};
+
+struct ring_sqe {
+    enum batch_op op;
+    int fd;
+    long off;
+};
+
+struct ring_cqe {
+    long res;
+};
+
+/*
+ * Single-producer rings, indices run freely and wrap on access, entry by
+ * entry. Both queues have RING_ENTRIES entries, so a batch always fits.
+ */
+static struct {
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+    unsigned int sq_head, sq_tail;
+    unsigned int cq_head, cq_tail;
+} ring;
+
+static char buf[SYSCALL_IO_MAX];
+static struct iovec iov[BATCH_MAX];
+static int fd = -1;
+static int sockfd[2] = { -1, -1 };
+
+static long issue_shim(const struct ring_sqe *e) {
+    switch (e->op) {
+    case BATCH_PREAD:
+        return uk_syscall_r_static4(SYS_pread64, e->fd, (long)buf,
+                                    io_size, e->off);
+    case BATCH_PWRITE:
+        return uk_syscall_r_static4(SYS_pwrite64, e->fd, (long)buf,
+                                    io_size, e->off);
+    case BATCH_SEND:
+        return uk_syscall_r_static3(SYS_write, e->fd, (long)buf, io_size);
+    case BATCH_RECV:
+        return uk_syscall_r_static3(SYS_read, e->fd, (long)buf, io_size);
+    }
+    return -EINVAL;
+}
+
+#ifdef HAVE_TRAP
+static long issue_trap(const struct ring_sqe *e) {
+    switch (e->op) {
+    case BATCH_PREAD:
+        return trap6(SYS_pread64, e->fd, (long)buf, io_size, e->off, 0, 0);
+    case BATCH_PWRITE:
+        return trap6(SYS_pwrite64, e->fd, (long)buf, io_size, e->off, 0, 0);
+    case BATCH_SEND:
+        return trap6(SYS_write, e->fd, (long)buf, io_size, 0, 0, 0);
+    case BATCH_RECV:
+        return trap6(SYS_read, e->fd, (long)buf, io_size, 0, 0, 0);
+    }
+    return -EINVAL;
+}
+#endif
+
+// The one entry per batch, always through the shim: run every queued
+// submission, post completions
+static __attribute__((noinline)) unsigned int ring_enter(void) {
+    unsigned int n = 0;
+
+    while (ring.sq_head != ring.sq_tail) {
+        ring.cq[ring.cq_tail++ % RING_ENTRIES].res =
+            issue_shim(&ring.sq[ring.sq_head++ % RING_ENTRIES]);
+        n++;
+    }
+    return n;
+}
+
+/*
+ * One workload. prep() fills the submissions of operation i of a batch
+ * and returns how many it used (at most 2); vec() does a whole batch of
+ * n operations in one vectored call and may be NULL.
+ */
+struct batch_work {
+    const char *name;
+    int (*setup)(void);
+    void (*teardown)(void);
+    unsigned int (*prep)(struct ring_sqe *e, unsigned int i);
+    long (*vec)(unsigned int n);
+};
+
+static void close_fd(int *f) {
+    if (*f >= 0)
+        uk_syscall_r_static1(SYS_close, *f);
+    *f = -1;
+}
+
+// A file covering a whole batch, each operation gets its own block
+static int create_file(void) {
+    long ret;
+
+    fd = uk_syscall_r_static3(SYS_open, (long)FILE_PATH,
+                              O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return fd;
+    for (unsigned int i = 0; i < batch_max; i++) {
+        ret = uk_syscall_r_static4(SYS_pwrite64, fd, (long)buf, io_size,
+                                   (long)i * io_size);
+        if (ret < 0) {
+            close_fd(&fd);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static void remove_file(void) {
+    close_fd(&fd);
+    uk_syscall_r_static1(SYS_unlink, (long)FILE_PATH);
+}
+
+static unsigned int prep_pread(struct ring_sqe *e, unsigned int i) {
+    e->op = BATCH_PREAD;
+    e->fd = fd;
+    e->off = (long)i * io_size;
+    return 1;
+}
+
+static unsigned int prep_pwrite(struct ring_sqe *e, unsigned int i) {
+    e->op = BATCH_PWRITE;
+    e->fd = fd;
+    e->off = (long)i * io_size;
+    return 1;
+}
+
+static long vec_pread(unsigned int n) {
+    return uk_syscall_r_static4(SYS_preadv, fd, (long)iov, n, 0);
+}
+
+static long vec_pwrite(unsigned int n) {
+    return uk_syscall_r_static4(SYS_pwritev, fd, (long)iov, n, 0);
+}
+
+static int open_socket(void) {
+    return uk_syscall_r_static4(SYS_socketpair, AF_UNIX, SOCK_STREAM, 0,
+                                (long)sockfd);
+}
+
+static void close_socket(void) {
+    close_fd(&sockfd[0]);
+    close_fd(&sockfd[1]);
+}
+
+/*
+ * A send of io_size bytes and the receive on the other end. The batch
+ * interleaves them, so the socket never holds more than one message and
+ * there is no vectored form that would not need n messages of buffer.
+ */
+static unsigned int prep_sock(struct ring_sqe *e, unsigned int i __unused) {
+    e[0].op = BATCH_SEND;
+    e[0].fd = sockfd[0];
+    e[1].op = BATCH_RECV;
+    e[1].fd = sockfd[1];
+    return 2;
+}
+
+static const struct batch_work works[] = {
+    { "pread",  create_file, remove_file,  prep_pread,  vec_pread  },
+    { "pwrite", create_file, remove_file,  prep_pwrite, vec_pwrite },
+    { "sock",   open_socket, close_socket, prep_sock,   NULL       },
+};
+
+enum batch_way {
+    BATCH_CALL,
+    BATCH_TRAP,
+    BATCH_RING,
+    BATCH_VEC,
+    BATCH_WAYS
+};
+
+static const char *const way_names[BATCH_WAYS] = {
+    [BATCH_CALL] = "call",
+    [BATCH_TRAP] = "trap",
+    [BATCH_RING] = "ring",
+    [BATCH_VEC]  = "vec",
+};
+
+// One submission as a direct call of its own
+static long issue(enum batch_way way, const struct ring_sqe *e) {
+#ifdef HAVE_TRAP
+    if (way == BATCH_TRAP)
+        return issue_trap(e);
+#endif
+    return issue_shim(e);
+}
+
+// A transfer that moved less than io_size bytes also counts as failed
+static int check_res(long res) {
+    return res == (long)io_size ? 0 : (res < 0 ? (int)res : -EIO);
+}
+
+// One batch of n operations, returns 0 or a negative errno
+static int run_batch(const struct batch_work *w, enum batch_way way,
+                     unsigned int n) {
+    struct ring_sqe e[2];
+    unsigned int k, done;
+    long res;
+    int ret = 0;
+
+    switch (way) {
+    case BATCH_CALL:
+#ifdef HAVE_TRAP
+    case BATCH_TRAP:
+#endif
+        for (unsigned int i = 0; i < n && !ret; i++) {
+            k = w->prep(e, i);
+            for (unsigned int j = 0; j < k && !ret; j++)
+                ret = check_res(issue(way, &e[j]));
+        }
+        return ret;
+    case BATCH_RING:
+        // An operation's entries may straddle the end of the ring
+        for (unsigned int i = 0; i < n; i++) {
+            k = w->prep(e, i);
+            for (unsigned int j = 0; j < k; j++)
+                ring.sq[ring.sq_tail++ % RING_ENTRIES] = e[j];
+        }
+        done = ring_enter();
+        for (; done; done--)
+            if (!ret)
+                ret = check_res(ring.cq[ring.cq_head++ % RING_ENTRIES].res);
+            else
+                ring.cq_head++;
+        return ret;
+    case BATCH_VEC:
+        res = w->vec(n);
+        return res == (long)n * io_size ? 0 : (res < 0 ? (int)res : -EIO);
+    default:
+        return -ENOSYS;
+    }
+}
+
+/*
+ * Run syscall.runs operations (at least one batch) of a workload in
+ * batches of n and print
+ *
+ *   SYSCALL_BATCH: <work> <way> batch=<n> ops=<operations per second>
+ */
+static int run_way(const struct batch_work *w, enum batch_way way,
+                   unsigned int n) {
+    unsigned int batches = runs / n ? runs / n : 1;
+    uint64_t start, end;
+    int ret;
+
+    // The first batch also warms up the path
+    ret = run_batch(w, way, n);
+    if (ret == -ENOSYS) {
+        printf("SYSCALL_SKIP: %s.%s err=%d\n", w->name, way_names[way],
+               ENOSYS);
+        return BENCH_EXIT_OK;
+    }
+
+    start = ukplat_monotonic_clock();
+    for (unsigned int b = 0; b < batches && !ret; b++)
+        ret = run_batch(w, way, n);
+    end = ukplat_monotonic_clock();
+
+    if (ret) {
+        printf("%s via %s, batch %u failed: err=%d\n", w->name,
+               way_names[way], n, -ret);
+        return BENCH_EXIT_FAIL;
+    }
+    printf("SYSCALL_BATCH: %s %s batch=%u ops=%" PRIu64 "\n",
+           w->name, way_names[way], n,
+           (uint64_t)((uint64_t)batches * n * UKARCH_NSEC_PER_SEC /
+                      (end - start)));
+    return BENCH_EXIT_OK;
+}
+
+static int run_work(const struct batch_work *w) {
+    int ret;
+
+    ret = w->setup();
+    if (ret < 0) {
+        printf("SYSCALL_SKIP: %s err=%d\n", w->name, -ret);
+        return BENCH_EXIT_OK;
+    }
+    ret = BENCH_EXIT_OK;
+    for (unsigned int n = 1; n <= batch_max && ret == BENCH_EXIT_OK; n *= 2)
+        for (unsigned int way = 0; way < BATCH_WAYS; way++) {
+            if (way == BATCH_VEC && !w->vec)
+                continue;
+            ret = run_way(w, way, n);
+            if (ret != BENCH_EXIT_OK)
+                break;
+        }
+    w->teardown();
+    return ret;
+}
+
+int mode_batch(void) {
+    int ret = BENCH_EXIT_OK;
+
+    if (!batch_max || batch_max > BATCH_MAX || io_size > SYSCALL_IO_MAX) {
+        printf("Need 0 < syscall.batch_max <= %u and syscall.io_size <= %u\n",
+               BATCH_MAX, SYSCALL_IO_MAX);
+        return BENCH_EXIT_FAIL;
+    }
+#ifdef CONFIG_LIBPOSIX_PIPE_SIZE_ORDER
+    // A send that does not fit the socket buffer would block forever
+    if (io_size >= 1UL << CONFIG_LIBPOSIX_PIPE_SIZE_ORDER) {
+        printf("Need syscall.io_size < %lu\n",
+               1UL << CONFIG_LIBPOSIX_PIPE_SIZE_ORDER);
+        return BENCH_EXIT_FAIL;
+    }
+#endif
+    for (unsigned int i = 0; i < BATCH_MAX; i++) {
+        iov[i].iov_base = buf;
+        iov[i].iov_len = io_size;
+    }
+
+    for (unsigned int i = 0; i < ARRAY_SIZE(works); i++)
+        if (run_work(&works[i]) != BENCH_EXIT_OK)
+            ret = BENCH_EXIT_FAIL;
+    return ret;
+}
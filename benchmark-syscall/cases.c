@@ -0,0 +1,369 @@
+/*
+ * The syscall matrix: every case works on a realistic target (devfs nodes,
+ * a ramfs file, a pipe, an epoll instance) set up before timing starts.
+ * Setup always goes through uk_syscall_r_static*(); the timed calls have a
+ * variant per path of syscall_bench.h where one exists.
+ */
+#include <errno.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <linux/futex.h>
+#include <uk/essentials.h>
+#include <uk/syscall.h>
+#include "syscall_bench.h"
+
+// Generated by the syscall shim, but nolibc has no prototype
+pid_t getpid(void);
+
+// Created on the ramfs root by the file cases
+#define FILE_PATH "/syscall-bench.dat"
+
+static char buf[SYSCALL_IO_MAX];
+static int fd = -1;
+static int pipefd[2] = { -1, -1 };
+static int epfd = -1;
+static uint32_t futex_word;
+
+static void close_fd(int *f) {
+    if (*f >= 0)
+        uk_syscall_r_static1(SYS_close, *f);
+    *f = -1;
+}
+
+static int open_path(const char *path, int flags) {
+    fd = uk_syscall_r_static3(SYS_open, (long)path, flags, 0644);
+    return fd < 0 ? fd : 0;
+}
+
+static void close_file(void) {
+    close_fd(&fd);
+}
+
+// libc-style wrappers return -1 and set errno
+static inline long libc_ret(long ret) {
+    return ret < 0 ? -errno : ret;
+}
+
+#ifdef HAVE_TRAP
+#define TRAP(fn) fn
+#else
+// Without the binary handler a syscall instruction would crash the guest
+#define TRAP(fn) NULL
+#endif
+
+static long do_getpid(void) {
+    return uk_syscall_r_static0(SYS_getpid);
+}
+
+static long libc_getpid(void) {
+    return getpid();
+}
+
+static long do_clock_gettime(void) {
+    struct timespec ts;
+
+    return uk_syscall_r_static2(SYS_clock_gettime, CLOCK_MONOTONIC, (long)&ts);
+}
+
+static long libc_clock_gettime(void) {
+    struct timespec ts;
+
+    return libc_ret(clock_gettime(CLOCK_MONOTONIC, &ts));
+}
+
+static int open_null(void) {
+    return open_path("/dev/null", O_RDWR);
+}
+
+static int open_zero(void) {
+    return open_path("/dev/zero", O_RDONLY);
+}
+
+static long do_read(void) {
+    return uk_syscall_r_static3(SYS_read, fd, (long)buf, io_size);
+}
+
+static long libc_read(void) {
+    return libc_ret(read(fd, buf, io_size));
+}
+
+static long do_write(void) {
+    return uk_syscall_r_static3(SYS_write, fd, (long)buf, io_size);
+}
+
+static long libc_write(void) {
+    return libc_ret(write(fd, buf, io_size));
+}
+
+// A file of io_size bytes, so that preads hit data and pwrites overwrite it
+static int create_file(void) {
+    long ret;
+
+    ret = open_path(FILE_PATH, O_RDWR | O_CREAT | O_TRUNC);
+    if (ret < 0)
+        return ret;
+    ret = uk_syscall_r_static3(SYS_write, fd, (long)buf, io_size);
+    if (ret < 0) {
+        close_file();
+        return ret;
+    }
+    return 0;
+}
+
+static void remove_file(void) {
+    close_file();
+    uk_syscall_r_static1(SYS_unlink, (long)FILE_PATH);
+}
+
+static long do_pread(void) {
+    return uk_syscall_r_static4(SYS_pread64, fd, (long)buf, io_size, 0);
+}
+
+static long libc_pread(void) {
+    return libc_ret(pread(fd, buf, io_size, 0));
+}
+
+static long do_pwrite(void) {
+    return uk_syscall_r_static4(SYS_pwrite64, fd, (long)buf, io_size, 0);
+}
+
+static long libc_pwrite(void) {
+    return libc_ret(pwrite(fd, buf, io_size, 0));
+}
+
+static long do_fstat(void) {
+    struct stat st;
+
+    return uk_syscall_r_static2(SYS_fstat, fd, (long)&st);
+}
+
+static long libc_fstat(void) {
+    struct stat st;
+
+    return libc_ret(fstat(fd, &st));
+}
+
+// Path lookup, file object and fd allocation, and their release
+static long do_open_close(void) {
+    long f = uk_syscall_r_static3(SYS_open, (long)FILE_PATH, O_RDONLY, 0);
+
+    if (f < 0)
+        return f;
+    return uk_syscall_r_static1(SYS_close, f);
+}
+
+static long libc_open_close(void) {
+    int f = open(FILE_PATH, O_RDONLY);
+
+    if (f < 0)
+        return -errno;
+    return libc_ret(close(f));
+}
+
+static int open_pipe(void) {
+#ifdef CONFIG_LIBPOSIX_PIPE_SIZE_ORDER
+    // A write that does not fit the buffer would block forever
+    if (io_size >= 1UL << CONFIG_LIBPOSIX_PIPE_SIZE_ORDER)
+        return -EINVAL;
+#endif
+    return uk_syscall_r_static1(SYS_pipe, (long)pipefd);
+}
+
+static void close_pipe(void) {
+    close_fd(&pipefd[0]);
+    close_fd(&pipefd[1]);
+}
+
+// One write into the pipe buffer and one read out of it
+static long do_pipe(void) {
+    long ret = uk_syscall_r_static3(SYS_write, pipefd[1], (long)buf, io_size);
+
+    if (ret < 0)
+        return ret;
+    return uk_syscall_r_static3(SYS_read, pipefd[0], (long)buf, io_size);
+}
+
+static long libc_pipe(void) {
+    if (write(pipefd[1], buf, io_size) < 0)
+        return -errno;
+    return libc_ret(read(pipefd[0], buf, io_size));
+}
+
+// Uncontended wake, the fast path of every mutex unlock
+static long do_futex_wake(void) {
+    return uk_syscall_r_static6(SYS_futex, (long)&futex_word,
+                                FUTEX_WAKE_PRIVATE, 1, 0, 0, 0);
+}
+
+// Map, fault in and unmap one anonymous page
+static long do_mmap(void) {
+    long p = uk_syscall_r_static6(SYS_mmap, 0, 4096, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p < 0)
+        return p;
+    *(volatile char *)p = 'a';
+    return uk_syscall_r_static2(SYS_munmap, p, 4096);
+}
+
+static long libc_mmap(void) {
+    char *p = mmap(NULL, 4096, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED)
+        return -errno;
+    *(volatile char *)p = 'a';
+    return libc_ret(munmap(p, 4096));
+}
+
+// An epoll instance watching a pipe that always holds a byte
+static int open_epoll(void) {
+    struct epoll_event ev = { .events = EPOLLIN };
+    long ret;
+
+    ret = open_pipe();
+    if (ret < 0)
+        return ret;
+    ret = uk_syscall_r_static3(SYS_write, pipefd[1], (long)buf, 1);
+    if (ret >= 0)
+        ret = epfd = uk_syscall_r_static1(SYS_epoll_create1, 0);
+    if (ret >= 0)
+        ret = uk_syscall_r_static4(SYS_epoll_ctl, epfd, EPOLL_CTL_ADD,
+                                   pipefd[0], (long)&ev);
+    if (ret < 0) {
+        close_fd(&epfd);
+        close_pipe();
+        return ret;
+    }
+    return 0;
+}
+
+static void close_epoll(void) {
+    close_fd(&epfd);
+    close_pipe();
+}
+
+static long do_epoll_wait(void) {
+    struct epoll_event ev[8];
+
+    return uk_syscall_r_static4(SYS_epoll_wait, epfd, (long)ev,
+                                ARRAY_SIZE(ev), 0);
+}
+
+static long libc_epoll_wait(void) {
+    struct epoll_event ev[8];
+
+    return libc_ret(epoll_wait(epfd, ev, ARRAY_SIZE(ev), 0));
+}
+
+#ifdef HAVE_TRAP
+static long trap_getpid(void) {
+    return trap6(SYS_getpid, 0, 0, 0, 0, 0, 0);
+}
+
+static long trap_clock_gettime(void) {
+    struct timespec ts;
+
+    return trap6(SYS_clock_gettime, CLOCK_MONOTONIC, (long)&ts, 0, 0, 0, 0);
+}
+
+static long trap_read(void) {
+    return trap6(SYS_read, fd, (long)buf, io_size, 0, 0, 0);
+}
+
+static long trap_write(void) {
+    return trap6(SYS_write, fd, (long)buf, io_size, 0, 0, 0);
+}
+
+static long trap_pread(void) {
+    return trap6(SYS_pread64, fd, (long)buf, io_size, 0, 0, 0);
+}
+
+static long trap_pwrite(void) {
+    return trap6(SYS_pwrite64, fd, (long)buf, io_size, 0, 0, 0);
+}
+
+static long trap_fstat(void) {
+    struct stat st;
+
+    return trap6(SYS_fstat, fd, (long)&st, 0, 0, 0, 0);
+}
+
+static long trap_open_close(void) {
+    long f = trap6(SYS_open, (long)FILE_PATH, O_RDONLY, 0, 0, 0, 0);
+
+    if (f < 0)
+        return f;
+    return trap6(SYS_close, f, 0, 0, 0, 0, 0);
+}
+
+static long trap_pipe(void) {
+    long ret = trap6(SYS_write, pipefd[1], (long)buf, io_size, 0, 0, 0);
+
+    if (ret < 0)
+        return ret;
+    return trap6(SYS_read, pipefd[0], (long)buf, io_size, 0, 0, 0);
+}
+
+static long trap_futex_wake(void) {
+    return trap6(SYS_futex, (long)&futex_word, FUTEX_WAKE_PRIVATE, 1,
+                 0, 0, 0);
+}
+
+static long trap_mmap(void) {
+    long p = trap6(SYS_mmap, 0, 4096, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p < 0)
+        return p;
+    *(volatile char *)p = 'a';
+    return trap6(SYS_munmap, p, 4096, 0, 0, 0, 0);
+}
+
+static long trap_epoll_wait(void) {
+    struct epoll_event ev[8];
+
+    return trap6(SYS_epoll_wait, epfd, (long)ev, ARRAY_SIZE(ev), 0, 0, 0);
+}
+#endif
+
+// Paths in the order of enum syscall_path: libc, shim, trap
+const struct syscall_case syscall_cases[] = {
+    { "getpid", NULL,
+      { libc_getpid, do_getpid, TRAP(trap_getpid) }, NULL },
+    { "clock_gettime", NULL,
+      { libc_clock_gettime, do_clock_gettime, TRAP(trap_clock_gettime) },
+      NULL },
+    { "read_null", open_null,
+      { libc_read, do_read, TRAP(trap_read) }, close_file },
+    { "write_null", open_null,
+      { libc_write, do_write, TRAP(trap_write) }, close_file },
+    { "read_zero", open_zero,
+      { libc_read, do_read, TRAP(trap_read) }, close_file },
+    { "pread_file", create_file,
+      { libc_pread, do_pread, TRAP(trap_pread) }, remove_file },
+    { "pwrite_file", create_file,
+      { libc_pwrite, do_pwrite, TRAP(trap_pwrite) }, remove_file },
+    { "fstat", create_file,
+      { libc_fstat, do_fstat, TRAP(trap_fstat) }, remove_file },
+    { "open_close", create_file,
+      { libc_open_close, do_open_close, TRAP(trap_open_close) },
+      remove_file },
+    { "pipe", open_pipe,
+      { libc_pipe, do_pipe, TRAP(trap_pipe) }, close_pipe },
+    { "futex_wake", NULL,
+      { NULL, do_futex_wake, TRAP(trap_futex_wake) }, NULL },
+    { "mmap", NULL,
+      { libc_mmap, do_mmap, TRAP(trap_mmap) }, NULL },
+    { "epoll_wait", open_epoll,
+      { libc_epoll_wait, do_epoll_wait, TRAP(trap_epoll_wait) },
+      close_epoll },
+};
+
+const unsigned int syscall_ncases = ARRAY_SIZE(syscall_cases);
@@ -0,0 +1,160 @@
+/*
+ * Time sources: what reading the time costs through each interface an
+ * application or the kernel can use, and how good the readings are.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/time.h>
+#include <uk/essentials.h>
+#include <uk/plat/time.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/timing.h>
+#include "syscall_bench.h"
+
+/*
+ * One time source. read() returns the current time in ns, or in counter
+ * cycles if cycles is set; check() returns 0 if the source is usable or
+ * a negative errno, and may be NULL. A monotonic source must never go
+ * backward, the wall clock may be stepped.
+ */
+struct clock_source {
+    const char *name;
+    uint64_t (*read)(void);
+    int (*check)(void);
+    int cycles;
+    int monotonic;
+};
+
+static struct bench_hist lat;
+
+static uint64_t read_monotonic(void) {
+    return ukplat_monotonic_clock();
+}
+
+static uint64_t read_wall(void) {
+    return ukplat_wall_clock();
+}
+
+static uint64_t timespec_ns(const struct timespec *ts) {
+    return (uint64_t)ts->tv_sec * UKARCH_NSEC_PER_SEC + ts->tv_nsec;
+}
+
+static uint64_t read_gettime_mono(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return timespec_ns(&ts);
+}
+
+static uint64_t read_gettime_real(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return timespec_ns(&ts);
+}
+
+static uint64_t read_gettimeofday(void) {
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * UKARCH_NSEC_PER_SEC + tv.tv_usec * 1000ULL;
+}
+
+static uint64_t read_cycles(void) {
+    return bench_cycles();
+}
+
+static int check_gettime_mono(void) {
+    struct timespec ts;
+
+    return clock_gettime(CLOCK_MONOTONIC, &ts) ? -errno : 0;
+}
+
+static int check_gettime_real(void) {
+    struct timespec ts;
+
+    return clock_gettime(CLOCK_REALTIME, &ts) ? -errno : 0;
+}
+
+static int check_gettimeofday(void) {
+    struct timeval tv;
+
+    return gettimeofday(&tv, NULL) ? -errno : 0;
+}
+
+static const struct clock_source sources[] = {
+    { "monotonic",    read_monotonic,    NULL,               0, 1 },
+    { "wall",         read_wall,         NULL,               0, 0 },
+    { "gettime_mono", read_gettime_mono, check_gettime_mono, 0, 1 },
+    { "gettime_real", read_gettime_real, check_gettime_real, 0, 0 },
+    { "gettimeofday", read_gettimeofday, check_gettimeofday, 0, 0 },
+    { "rdtsc",        read_cycles,       NULL,               1, 1 },
+};
+
+/*
+ * Read the source syscall.runs times back to back. Besides the latency
+ * of a read this gives, from consecutive readings:
+ *   res      the smallest step the source ever advanced by
+ *   repeats  readings equal to the one before, the source did not tick
+ *   backward readings lower than the one before
+ * A source whose resolution is coarser than its read latency returns the
+ * same value several times in a row; it cannot tell apart events closer
+ * than res. A monotonic source that went backward fails the run.
+ */
+static int run_source(const struct clock_source *c) {
+    uint64_t t0, now, prev, res = UINT64_MAX, repeats = 0, backward = 0;
+    char name[32];
+    int ret;
+
+    ret = c->check ? c->check() : 0;
+    if (ret < 0) {
+        printf("CLOCK_SKIP: %s err=%d\n", c->name, -ret);
+        return BENCH_EXIT_OK;
+    }
+
+    bench_hist_reset(&lat);
+    prev = c->read();
+    for (unsigned int i = 0; i < runs; i++) {
+        t0 = bench_timing_start();
+        now = c->read();
+        bench_keep(now);
+        bench_hist_record(&lat, bench_timing_net(bench_timing_stop() - t0));
+
+        if (now == prev)
+            repeats++;
+        else if (now < prev)
+            backward++;
+        else if (now - prev < res)
+            res = now - prev;
+        prev = now;
+    }
+
+    if (res == UINT64_MAX)
+        res = 0;
+    else if (c->cycles)
+        res = bench_cycles_to_ns(res);
+    printf("CLOCK_SOURCE: %s avg=%" PRIu64 " res=%" PRIu64
+           " repeats=%" PRIu64 " backward=%" PRIu64 "\n",
+           c->name, bench_cycles_to_ns(lat.sum / lat.count), res,
+           repeats, backward);
+    snprintf(name, sizeof(name), "clock.%s", c->name);
+    bench_hist_print(&lat, name);
+    if (c->monotonic && backward) {
+        printf("%s went backward %" PRIu64 " times\n", c->name, backward);
+        return BENCH_EXIT_FAIL;
+    }
+    return BENCH_EXIT_OK;
+}
+
+int mode_clocks(void) {
+    int ret = BENCH_EXIT_OK;
+
+    for (unsigned int i = 0; i < ARRAY_SIZE(sources); i++)
+        if (run_source(&sources[i]) != BENCH_EXIT_OK)
+            ret = BENCH_EXIT_FAIL;
+    return ret;
+}
@@ -1,20 +1,223 @@
 #include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
 #include <uk/essentials.h>
-#include <uk/syscall.h>
-#include <uk/time.h>
 #include <uk/assert.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include <bench/timing.h>
+#include "syscall_bench.h"
 
-int main(void) {
-    uint64_t start, end;
-    int runs = 100000;
+// Set on the kernel command line, e.g. "syscall.runs=1000000 --"
+static char *mode = "matrix";
+unsigned int runs = 100000;
+// Comma-separated cases of the matrix, see cases.c
+static char *list = "getpid,clock_gettime,read_null,write_null,read_zero,"
+                    "pread_file,pwrite_file,fstat,open_close,pipe,"
+                    "futex_wake,mmap,epoll_wait";
+// Comma-separated paths every case is timed through
+static char *paths = "libc,shim,trap";
+unsigned int io_size = 4096;
+
+UK_LIBPARAM_PARAM(mode, charp, "Benchmark to run, see modes[]");
+UK_LIBPARAM_PARAM(runs, uint, "Number of calls to time");
+UK_LIBPARAM_PARAM(list, charp, "System calls to time");
+UK_LIBPARAM_PARAM(paths, charp, "Paths into the handler: libc,shim,trap");
+UK_LIBPARAM_PARAM(io_size, uint, "Bytes per read/write");
+
+static const char *const path_names[SYSCALL_PATHS] = {
+    [SYSCALL_LIBC] = "libc",
+    [SYSCALL_SHIM] = "shim",
+    [SYSCALL_TRAP] = "trap",
+};
+
+static struct bench_hist lat[SYSCALL_PATHS];
+
+// Length of the item at p in a comma-separated list
+static size_t item_len(const char *p) {
+    const char *end = strchr(p, ',');
+
+    return end ? (size_t)(end - p) : strlen(p);
+}
+
+static int item_is(const char *p, size_t len, const char *name) {
+    return strlen(name) == len && !strncmp(name, p, len);
+}
+
+static const struct syscall_case *find_case(const char *name, size_t len) {
+    for (unsigned int i = 0; i < syscall_ncases; i++)
+        if (item_is(name, len, syscall_cases[i].name))
+            return &syscall_cases[i];
+    return NULL;
+}
 
-    start = ukplat_monotonic_clock();
-    for (int i = 0; i < runs; i++) {
-        syscall0(__NR_getpid);
+// Bit mask of the paths in syscall.paths, 0 if one is unknown
+static unsigned int parse_paths(void) {
+    unsigned int mask = 0, p;
+    size_t len;
+
+    for (const char *s = paths; *s; s += len + !!s[len]) {
+        len = item_len(s);
+        for (p = 0; p < SYSCALL_PATHS; p++)
+            if (item_is(s, len, path_names[p]))
+                break;
+        if (p == SYSCALL_PATHS) {
+            printf("Unknown syscall path: %.*s\n", (int)len, s);
+            return 0;
+        }
+        mask |= 1u << p;
+    }
+    if (!mask)
+        printf("syscall.paths must not be empty\n");
+    return mask;
+}
+
+/*
+ * Time one case through one path. A path the image does not provide
+ * (-ENOSYS, or no variant at all) is skipped with
+ *
+ *   SYSCALL_SKIP: <name>.<path> err=<errno>
+ *
+ * A call that fails once it worked is an error.
+ */
+static int run_path(const struct syscall_case *c, unsigned int p) {
+    uint64_t t0, failed = 0;
+    long (*call)(void) = c->call[p];
+    long ret;
+
+    // The first call also warms up the path
+    ret = call ? call() : -ENOSYS;
+    if (ret == -ENOSYS) {
+        printf("SYSCALL_SKIP: %s.%s err=%d\n", c->name, path_names[p], ENOSYS);
+        return BENCH_EXIT_OK;
+    }
+    if (ret < 0) {
+        printf("%s() via %s failed: err=%ld\n", c->name, path_names[p], -ret);
+        return BENCH_EXIT_FAIL;
+    }
+
+    for (unsigned int i = 0; i < runs; i++) {
+        t0 = bench_timing_start();
+        ret = call();
+        bench_keep(ret);
+        bench_hist_record(&lat[p], bench_timing_net(bench_timing_stop() - t0));
+        failed += ret < 0;
     }
-    end = ukplat_monotonic_clock();
 
-    printf("[Syscall Latency] getpid(): %.2f ns\n", (double)(end - start) * 1e9 / runs / UKPLAT_CLOCK_TICKS_PER_SEC);
-    return 0;
+    if (failed) {
+        printf("%s() via %s failed %" PRIu64 " of %u times, last err=%ld\n",
+               c->name, path_names[p], failed, runs, -ret);
+        return BENCH_EXIT_FAIL;
+    }
+    // The shim is the reference path and keeps the plain names
+    if (p == SYSCALL_SHIM)
+        printf("[Syscall Latency] %s(): %" PRIu64 " ns\n", c->name,
+               bench_cycles_to_ns(lat[p].sum / lat[p].count));
+    return BENCH_EXIT_OK;
 }
 
+/*
+ * Time one case through every path of the mask. A target that cannot be
+ * set up skips the whole case, so that a minimal image still runs the
+ * rest of the matrix. With more than one path, the medians are compared:
+ *
+ *   SYSCALL_PATH: <name> libc=<ns> shim=<ns> trap=<ns>
+ */
+static int run_case(const struct syscall_case *c, unsigned int mask) {
+    unsigned int p, timed = 0;
+    char name[64];
+    int ret;
+
+    ret = c->setup ? c->setup() : 0;
+    if (ret < 0) {
+        printf("SYSCALL_SKIP: %s err=%d\n", c->name, -ret);
+        return BENCH_EXIT_OK;
+    }
+    ret = BENCH_EXIT_OK;
+    for (p = 0; p < SYSCALL_PATHS && ret == BENCH_EXIT_OK; p++) {
+        bench_hist_reset(&lat[p]);
+        if (mask & (1u << p))
+            ret = run_path(c, p);
+    }
+    if (c->teardown)
+        c->teardown();
+    if (ret != BENCH_EXIT_OK)
+        return ret;
+
+    for (p = 0; p < SYSCALL_PATHS; p++) {
+        if (!lat[p].count)
+            continue;
+        if (p == SYSCALL_SHIM)
+            snprintf(name, sizeof(name), "%s", c->name);
+        else
+            snprintf(name, sizeof(name), "%s.%s", c->name, path_names[p]);
+        bench_hist_print(&lat[p], name);
+        timed++;
+    }
+    if (timed > 1) {
+        printf("SYSCALL_PATH: %s", c->name);
+        for (p = 0; p < SYSCALL_PATHS; p++)
+            if (lat[p].count)
+                printf(" %s=%" PRIu64, path_names[p],
+                       bench_cycles_to_ns(bench_hist_percentile(&lat[p], 500)));
+        printf("\n");
+    }
+    return BENCH_EXIT_OK;
+}
+
+int mode_matrix(void) {
+    const struct syscall_case *c;
+    unsigned int mask;
+    int ret = BENCH_EXIT_OK;
+    size_t len;
+
+    if (io_size > SYSCALL_IO_MAX) {
+        printf("Need syscall.io_size <= %u\n", SYSCALL_IO_MAX);
+        return BENCH_EXIT_FAIL;
+    }
+    mask = parse_paths();
+    if (!mask)
+        return BENCH_EXIT_FAIL;
+
+    for (const char *p = list; *p; p += len + !!p[len]) {
+        len = item_len(p);
+        c = find_case(p, len);
+        if (!c) {
+            printf("Unknown syscall case: %.*s\n", (int)len, p);
+            ret = BENCH_EXIT_FAIL;
+        } else if (run_case(c, mask) != BENCH_EXIT_OK) {
+            ret = BENCH_EXIT_FAIL;
+        }
+    }
+    return ret;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(void);
+} modes[] = {
+    { "matrix", mode_matrix },
+    { "clocks", mode_clocks },
+    { "batch",  mode_batch },
+};
+
+int main(void) {
+    if (!runs) {
+        printf("Need syscall.runs > 0\n");
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+
+    for (unsigned int i = 0; i < ARRAY_SIZE(modes); i++) {
+        if (!strcmp(mode, modes[i].name)) {
+            printf("[SYSCALL] mode=%s\n", mode);
+            bench_timing_init();
+            bench_finish(modes[i].run());
+        }
+    }
+
+    printf("Unknown mode: %s\n", mode);
+    bench_finish(BENCH_EXIT_FAIL);
+}
@@ -0,0 +1,69 @@
+#ifndef SYSCALL_BENCH_H
+#define SYSCALL_BENCH_H
+
+// Shared parameters, set on the kernel command line (see main.c)
+extern unsigned int runs;
+// Bytes moved per read/write/pread/pwrite
+extern unsigned int io_size;
+
+// Largest syscall.io_size, the pipe case needs it to fit the pipe buffer
+#define SYSCALL_IO_MAX 65536
+
+/*
+ * The ways into a system call handler: the libc-style wrapper that sets
+ * errno, the direct uk_syscall_r_static*() binding of a recompiled
+ * application, and the syscall instruction an unmodified Linux binary
+ * issues, which goes through the binary system call handler.
+ */
+enum syscall_path {
+    SYSCALL_LIBC,
+    SYSCALL_SHIM,
+    SYSCALL_TRAP,
+    SYSCALL_PATHS
+};
+
+#if CONFIG_LIBSYSCALL_SHIM_HANDLER && CONFIG_ARCH_X86_64
+#define HAVE_TRAP 1
+
+// A raw Linux ABI system call, as an unmodified binary issues it
+static inline long trap6(long nr, long a, long b, long c, long d, long e,
+                         long f) {
+    register long r10 __asm__("r10") = d;
+    register long r8 __asm__("r8") = e;
+    register long r9 __asm__("r9") = f;
+    long ret;
+
+    __asm__ __volatile__("syscall"
+                         : "=a"(ret)
+                         : "a"(nr), "D"(a), "S"(b), "d"(c),
+                           "r"(r10), "r"(r8), "r"(r9)
+                         : "rcx", "r11", "memory");
+    return ret;
+}
+#endif
+
+/*
+ * One entry of the syscall matrix. setup() opens whatever the calls work
+ * on and returns 0 or a negative errno; call[path]() issues the timed
+ * system call(s) and returns the raw result, negative errno on errors.
+ * setup, teardown and a path without a variant may be NULL.
+ */
+struct syscall_case {
+    const char *name;
+    int (*setup)(void);
+    long (*call[SYSCALL_PATHS])(void);
+    void (*teardown)(void);
+};
+
+extern const struct syscall_case syscall_cases[];
+extern const unsigned int syscall_ncases;
+
+/*
+ * Benchmarks, selected with syscall.mode=<name>. Each returns a
+ * BENCH_EXIT_* code for bench_finish().
+ */
+int mode_matrix(void);
+int mode_clocks(void);
+int mode_batch(void);
+
+#endif
@@ -1,33 +1,177 @@
 #include <uk/netdev.h>
 #include <stdio.h>
 #include <lwip/sockets.h>
-#include <uk/time.h>
+#include <uk/plat/time.h>
 #include <string.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <uk/essentials.h>
+#include <uk/libparam.h>
+#include <bench/cycles.h>
+#include <bench/finish.h>
+#include <bench/hist.h>
+#include "tcp_bench.h"
 
-#define SIZE 4096
-#define REPS 100000
+// Set on the kernel command line, e.g. "tcp.size=1024 tcp.reps=10000 --"
+static char *mode = "rr";
+static unsigned int size = 4096;
+static unsigned int req_size;
+static unsigned int resp_size;
+static unsigned int reps = 100000;
+static unsigned int duration = 10;
+static unsigned long bytes;
+static char *server = "10.0.2.2";
+static unsigned int port = 12345;
+
+UK_LIBPARAM_PARAM(mode, charp, "Workload to run, see modes[]");
+UK_LIBPARAM_PARAM(size, uint, "Message size in bytes");
+UK_LIBPARAM_PARAM(req_size, uint, "Request size of rr, default tcp.size");
+UK_LIBPARAM_PARAM(resp_size, uint, "Response size of rr, default tcp.size");
+UK_LIBPARAM_PARAM(reps, uint, "Number of request/response transactions");
+UK_LIBPARAM_PARAM(duration, uint, "Seconds to stream for");
+UK_LIBPARAM_PARAM(bytes, ulong, "Bytes to stream, overrides duration");
+UK_LIBPARAM_PARAM(server, charp, "Server IPv4 address");
+UK_LIBPARAM_PARAM(port, uint, "Server TCP port");
+
+static struct bench_hist rtt_lat;
+static struct bench_hist send_lat;
+
+// bits per nanosecond == Gbit/s; print with two decimals (no %f in nolibc)
+static void print_throughput(uint64_t total, uint64_t ns) {
+    uint64_t mbps = total * 8 * 1000 / ns;
+
+    printf("[TCP] Throughput: %" PRIu64 ".%02" PRIu64 " Gbps\n",
+           mbps / 1000, (mbps % 1000) / 10);
+}
+
+/*
+ * Request/response transactions: send a tcp.req_size request, wait for
+ * the whole tcp.resp_size response, repeat tcp.reps times. The server
+ * knows both sizes from the same parameters, so messages need no header
+ * and 1-byte transactions are exactly that on the wire.
+ *
+ *   TCP_RR: <transactions/s> req=<B> resp=<B> p50=.. p99=.. p99.9=.. ns
+ */
+static int mode_rr(int sockfd, char *buffer) {
+    uint64_t start, end, t0;
+
+    start = ukplat_monotonic_clock();
+    for (unsigned int i = 0; i < reps; i++) {
+        t0 = bench_cycles();
+        if (tcp_send_all(sockfd, buffer, req_size) < 0 ||
+            tcp_recv_all(sockfd, buffer, resp_size)) {
+            printf("Transaction %u failed\n", i);
+            return BENCH_EXIT_FAIL;
+        }
+        bench_hist_record(&rtt_lat, bench_cycles() - t0);
+    }
+    end = ukplat_monotonic_clock();
+
+    printf("TCP_RR: %" PRIu64 " trans/s req=%u resp=%u p50=%" PRIu64
+           " p99=%" PRIu64 " p99.9=%" PRIu64 " ns\n",
+           (uint64_t)((uint64_t)reps * UKARCH_NSEC_PER_SEC / (end - start)),
+           req_size, resp_size,
+           bench_cycles_to_ns(bench_hist_percentile(&rtt_lat, 500)),
+           bench_cycles_to_ns(bench_hist_percentile(&rtt_lat, 990)),
+           bench_cycles_to_ns(bench_hist_percentile(&rtt_lat, 999)));
+    bench_hist_print(&rtt_lat, "rtt");
+    return BENCH_EXIT_OK;
+}
+
+/*
+ * Push a continuous stream of size-byte sends for tcp.duration seconds,
+ * or tcp.bytes bytes if set, then half-close. The server answers with the
+ * number of bytes it received once it sees the end of the stream, so the
+ * client's time includes draining its send buffer and the count shows
+ * that nothing was lost:
+ *
+ *   TCP_STREAM: client bytes=<n> ns=<elapsed> mbps=<goodput>
+ */
+static int mode_stream(int sockfd, char *buffer) {
+    uint64_t start, end, deadline, t0, sent = 0, received;
+    size_t chunk = size;
+
+    start = ukplat_monotonic_clock();
+    deadline = start + (uint64_t)duration * UKARCH_NSEC_PER_SEC;
+    while (bytes ? sent < bytes : ukplat_monotonic_clock() < deadline) {
+        if (bytes && bytes - sent < chunk)
+            chunk = bytes - sent;
+        t0 = bench_cycles();
+        if (tcp_send_all(sockfd, buffer, chunk) < 0) {
+            printf("Stream send failed after %" PRIu64 " bytes\n", sent);
+            return BENCH_EXIT_FAIL;
+        }
+        bench_hist_record(&send_lat, bench_cycles() - t0);
+        sent += chunk;
+    }
+    shutdown(sockfd, SHUT_WR);
+    if (tcp_recv_all(sockfd, &received, sizeof(received))) {
+        printf("No byte count from the server\n");
+        return BENCH_EXIT_FAIL;
+    }
+    end = ukplat_monotonic_clock();
+
+    if (received != sent) {
+        printf("Server received %" PRIu64 " of %" PRIu64 " bytes\n",
+               received, sent);
+        return BENCH_EXIT_FAIL;
+    }
+    printf("TCP_STREAM: client bytes=%" PRIu64 " ns=%" PRIu64
+           " mbps=%" PRIu64 "\n",
+           sent, end - start, sent * 8 * 1000 / (end - start));
+    print_throughput(sent, end - start);
+    bench_hist_print(&send_lat, "send");
+    return BENCH_EXIT_OK;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(int sockfd, char *buffer);
+} modes[] = {
+    { "rr",     mode_rr },
+    { "stream", mode_stream },
+};
 
 int main(void) {
-    int sockfd;
+    int sockfd, ret, one = 1;
     struct sockaddr_in servaddr;
-    char buffer[SIZE] = "A";
-    uint64_t start, end;
+    char *buffer;
+
+    req_size = req_size ? req_size : size;
+    resp_size = resp_size ? resp_size : size;
+    if (!size || req_size > TCP_MSG_MAX || resp_size > TCP_MSG_MAX) {
+        printf("Need tcp.size > 0 and request/response sizes <= %u\n",
+               TCP_MSG_MAX);
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+
+    buffer = calloc(1, MAX(size, MAX(req_size, resp_size)));
+    if (!buffer)
+        bench_finish(BENCH_EXIT_FAIL);
+    buffer[0] = 'A';
 
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
     servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = inet_addr("10.0.2.2");
-    servaddr.sin_port = htons(12345);
+    servaddr.sin_addr.s_addr = inet_addr(server);
+    servaddr.sin_port = htons(port);
 
-    connect(sockfd, (struct sockaddr*)&servaddr, sizeof(servaddr));
-    start = ukplat_monotonic_clock();
-    for (int i = 0; i < REPS; i++) {
-        send(sockfd, buffer, SIZE, 0);
-        recv(sockfd, buffer, SIZE, 0);
+    if (connect(sockfd, (struct sockaddr*)&servaddr, sizeof(servaddr)) < 0) {
+        printf("Cannot connect to %s:%u\n", server, port);
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+    // Small requests must not wait for Nagle to coalesce them
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    for (unsigned int i = 0; i < ARRAY_SIZE(modes); i++) {
+        if (!strcmp(mode, modes[i].name)) {
+            printf("[TCP] mode=%s size=%u\n", mode, size);
+            ret = modes[i].run(sockfd, buffer);
+            close(sockfd);
+            bench_finish(ret);
+        }
     }
-    end = ukplat_monotonic_clock();
 
-    double time_sec = (end - start) / (double)UKPLAT_CLOCK_TICKS_PER_SEC;
-    double throughput = (double)(SIZE * REPS * 8) / (time_sec * 1e9);
-    printf("[TCP] Throughput: %.2f Gbps\n", throughput);
-    return 0;
+    printf("Unknown mode: %s\n", mode);
+    close(sockfd);
+    bench_finish(BENCH_EXIT_FAIL);
 }
@@ -0,0 +1,30 @@
+#include <lwip/sockets.h>
+#include "tcp_bench.h"
+
+int tcp_send_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    ssize_t n;
+
+    while (len) {
+        n = send(fd, p, len, 0);
+        if (n <= 0)
+            return -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int tcp_recv_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    ssize_t n;
+
+    while (len) {
+        n = recv(fd, p, len, 0);
+        if (n <= 0)
+            return !n && p == buf ? 1 : -1;
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
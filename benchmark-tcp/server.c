@@ -1,33 +1,138 @@
 #include <uk/netdev.h>
 #include <stdio.h>
 #include <lwip/sockets.h>
-#include <uk/time.h>
+#include <uk/plat/time.h>
 #include <string.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <uk/essentials.h>
+#include <uk/libparam.h>
+#include <bench/finish.h>
+#include "tcp_bench.h"
 
-int main(void) {
-    int sockfd, connfd;
-    struct sockaddr_in servaddr, cli;
-    char buffer[4096];
+// Set on the kernel command line, e.g. "tcp.size=65536 --"
+static char *mode = "rr";
+static unsigned int size = 4096;
+static unsigned int req_size;
+static unsigned int resp_size;
+static unsigned int port = 12345;
+
+UK_LIBPARAM_PARAM(mode, charp, "Workload to serve, same as the client's");
+UK_LIBPARAM_PARAM(size, uint, "Receive buffer size in bytes");
+UK_LIBPARAM_PARAM(req_size, uint, "Request size of rr, default tcp.size");
+UK_LIBPARAM_PARAM(resp_size, uint, "Response size of rr, default tcp.size");
+UK_LIBPARAM_PARAM(port, uint, "TCP port to listen on");
+
+// Answer every tcp.req_size request with tcp.resp_size bytes
+static int mode_rr(int connfd, char *buffer) {
+    uint64_t start, end, trans = 0;
+    int ret;
+
+    start = ukplat_monotonic_clock();
+    while (!(ret = tcp_recv_all(connfd, buffer, req_size))) {
+        if (tcp_send_all(connfd, buffer, resp_size) < 0) {
+            ret = -1;
+            break;
+        }
+        trans++;
+    }
+    end = ukplat_monotonic_clock();
+    if (ret < 0) {
+        printf("Transaction %" PRIu64 " failed\n", trans);
+        return BENCH_EXIT_FAIL;
+    }
+
+    uint64_t duration_ms = (end - start) / 1000000;
+    printf("[TCP] Server transfer duration: %" PRIu64 ".%03" PRIu64 " seconds\n",
+           duration_ms / 1000, duration_ms % 1000);
+    return BENCH_EXIT_OK;
+}
+
+/*
+ * Count the bytes of the client's stream until its half-close, then send
+ * the count back:
+ *
+ *   TCP_STREAM: server bytes=<n> ns=<elapsed> mbps=<goodput>
+ */
+static int mode_stream(int connfd, char *buffer) {
+    uint64_t start, end, received = 0;
     int len;
-    uint64_t start, end;
+
+    start = ukplat_monotonic_clock();
+    while ((len = recv(connfd, buffer, size, 0)) > 0)
+        received += len;
+    end = ukplat_monotonic_clock();
+    if (len < 0 || !received) {
+        printf("Stream ended after %" PRIu64 " bytes\n", received);
+        return BENCH_EXIT_FAIL;
+    }
+    if (tcp_send_all(connfd, &received, sizeof(received)) < 0)
+        return BENCH_EXIT_FAIL;
+
+    printf("TCP_STREAM: server bytes=%" PRIu64 " ns=%" PRIu64
+           " mbps=%" PRIu64 "\n",
+           received, end - start, received * 8 * 1000 / (end - start));
+    return BENCH_EXIT_OK;
+}
+
+static const struct {
+    const char *name;
+    int (*run)(int connfd, char *buffer);
+} modes[] = {
+    { "rr",     mode_rr },
+    { "stream", mode_stream },
+};
+
+int main(void) {
+    int sockfd, connfd, ret = BENCH_EXIT_FAIL, one = 1;
+    struct sockaddr_in servaddr;
+    char *buffer;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(modes); i++)
+        if (!strcmp(mode, modes[i].name))
+            break;
+    if (i == ARRAY_SIZE(modes)) {
+        printf("Unknown mode: %s\n", mode);
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+
+    req_size = req_size ? req_size : size;
+    resp_size = resp_size ? resp_size : size;
+    if (!size || req_size > TCP_MSG_MAX || resp_size > TCP_MSG_MAX) {
+        printf("Need tcp.size > 0 and request/response sizes <= %u\n",
+               TCP_MSG_MAX);
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+    buffer = malloc(MAX(size, MAX(req_size, resp_size)));
+    if (!buffer)
+        bench_finish(BENCH_EXIT_FAIL);
 
     sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        printf("Cannot create a socket\n");
+        bench_finish(BENCH_EXIT_FAIL);
+    }
     servaddr.sin_family = AF_INET;
     servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(12345);
+    servaddr.sin_port = htons(port);
 
-    bind(sockfd, (struct sockaddr*)&servaddr, sizeof(servaddr));
-    listen(sockfd, 1);
+    // The harness starts the client on READY, so fail here, not there
+    if (bind(sockfd, (struct sockaddr*)&servaddr, sizeof(servaddr)) < 0 ||
+        listen(sockfd, 1) < 0) {
+        printf("Cannot listen on port %u\n", port);
+        close(sockfd);
+        bench_finish(BENCH_EXIT_FAIL);
+    }
+    printf("TCP_SERVER_READY\n");  // harness waits for this before starting the client
     connfd = accept(sockfd, (struct sockaddr*)NULL, NULL);
 
-    start = ukplat_monotonic_clock();
-    while ((len = recv(connfd, buffer, sizeof(buffer), 0)) > 0) {
-        // simulate echo
-        send(connfd, buffer, len, 0);
+    if (connfd >= 0) {
+        // Responses must not wait for Nagle either, the client times them
+        setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        ret = modes[i].run(connfd, buffer);
     }
-    end = ukplat_monotonic_clock();
-
-    double duration = (end - start) / (double)UKPLAT_CLOCK_TICKS_PER_SEC;
-    printf("[TCP] Server transfer duration: %.2f seconds\n", duration);
-    return 0;
+    close(connfd);
+    close(sockfd);
+    bench_finish(ret);
 }
@@ -0,0 +1,18 @@
+#ifndef TCP_BENCH_H
+#define TCP_BENCH_H
+
+#include <stddef.h>
+
+// Largest tcp.req_size/resp_size of the rr mode
+#define TCP_MSG_MAX 65536
+
+/*
+ * Send or receive exactly len bytes, looping over short transfers.
+ * Return 0, or -1 if the connection failed or was closed before.
+ * tcp_recv_all() returns 1 if the peer closed the connection before
+ * the first byte, the clean end of a message stream.
+ */
+int tcp_send_all(int fd, const void *buf, size_t len);
+int tcp_recv_all(int fd, void *buf, size_t len);
+
+#endif
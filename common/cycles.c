@@ -0,0 +1,42 @@
+#include <uk/plat/time.h>
+#include <bench/cycles.h>
+
+#define CALIBRATE_NSEC (10 * 1000000ULL) // 10 ms
+
+static uint64_t cycles_freq;
+
+static uint64_t cycles_calibrate(void) {
+#if defined(__aarch64__)
+    uint64_t freq;
+
+    __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(freq));
+    return freq;
+#else
+    uint64_t c0, c1;
+    __nsec t0, t1;
+
+    // Spin on the platform clock; the counter keeps running meanwhile
+    t0 = ukplat_monotonic_clock();
+    c0 = bench_cycles();
+    do {
+        t1 = ukplat_monotonic_clock();
+    } while (t1 - t0 < CALIBRATE_NSEC);
+    c1 = bench_cycles();
+
+    return (c1 - c0) * UKARCH_NSEC_PER_SEC / (t1 - t0);
+#endif
+}
+
+uint64_t bench_cycles_freq(void) {
+    if (!cycles_freq)
+        cycles_freq = cycles_calibrate();
+    return cycles_freq;
+}
+
+uint64_t bench_cycles_to_ns(uint64_t cycles) {
+    uint64_t freq = bench_cycles_freq();
+
+    // Split to avoid overflowing cycles * 1e9 after a few seconds of uptime
+    return (cycles / freq) * UKARCH_NSEC_PER_SEC +
+           (cycles % freq) * UKARCH_NSEC_PER_SEC / freq;
+}
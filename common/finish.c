@@ -0,0 +1,19 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <uk/plat/bootstrap.h>
+#include <bench/finish.h>
+
+// Same port libkvmplat pokes on crash; QEMU ignores it without the device
+#define ISA_DEBUG_EXIT_PORT 0x501
+
+void bench_finish(int result) {
+    fflush(stdout);
+
+#if defined(__x86_64__)
+    __asm__ __volatile__("outw %w0, %w1"
+                         : : "a"((uint16_t)result),
+                             "Nd"((uint16_t)ISA_DEBUG_EXIT_PORT));
+#endif
+
+    ukplat_terminate(result == BENCH_EXIT_OK ? UKPLAT_HALT : UKPLAT_CRASH);
+}
@@ -0,0 +1,74 @@
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <bench/cycles.h>
+#include <bench/hist.h>
+
+void bench_hist_reset(struct bench_hist *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+void bench_hist_merge(struct bench_hist *to, const struct bench_hist *from) {
+    if (!from->count)
+        return;
+    for (unsigned int i = 0; i < BENCH_HIST_BUCKETS; i++)
+        to->buckets[i] += from->buckets[i];
+    if (!to->count || from->min < to->min)
+        to->min = from->min;
+    if (from->max > to->max)
+        to->max = from->max;
+    to->count += from->count;
+    to->sum += from->sum;
+}
+
+// Highest value that falls into bucket idx
+static uint64_t bucket_top(unsigned int idx) {
+    unsigned int shift;
+
+    if (idx < 2 * BENCH_HIST_SUB)
+        return idx;
+    shift = idx / BENCH_HIST_SUB - 1;
+    return (((uint64_t)(idx - shift * BENCH_HIST_SUB) + 1) << shift) - 1;
+}
+
+uint64_t bench_hist_percentile(const struct bench_hist *h, unsigned int permille) {
+    uint64_t rank, seen = 0;
+
+    if (!h->count)
+        return 0;
+
+    // Nearest rank, at least the first sample
+    rank = (h->count * permille + 999) / 1000;
+    if (!rank)
+        rank = 1;
+
+    for (unsigned int i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            uint64_t v = bucket_top(i);
+
+            // The exact extremes are known, don't report past them
+            if (v > h->max)
+                v = h->max;
+            if (v < h->min)
+                v = h->min;
+            return v;
+        }
+    }
+    return h->max;
+}
+
+void bench_hist_print(const struct bench_hist *h, const char *name) {
+    printf("LAT_HIST: %s count=%" PRIu64
+           " min=%" PRIu64 " avg=%" PRIu64
+           " p50=%" PRIu64 " p90=%" PRIu64 " p99=%" PRIu64
+           " p99.9=%" PRIu64 " max=%" PRIu64 " ns\n",
+           name, h->count,
+           bench_cycles_to_ns(h->min),
+           h->count ? bench_cycles_to_ns(h->sum / h->count) : 0,
+           bench_cycles_to_ns(bench_hist_percentile(h, 500)),
+           bench_cycles_to_ns(bench_hist_percentile(h, 900)),
+           bench_cycles_to_ns(bench_hist_percentile(h, 990)),
+           bench_cycles_to_ns(bench_hist_percentile(h, 999)),
+           bench_cycles_to_ns(h->max));
+}
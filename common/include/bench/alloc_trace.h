@@ -0,0 +1,44 @@
+#ifndef BENCH_ALLOC_TRACE_H
+#define BENCH_ALLOC_TRACE_H
+
+#include <stdint.h>
+
+/*
+ * Binary allocation trace, written by scripts/alloc_trace.c on the host and
+ * replayed by benchmark-malloc (malloc.mode=replay). Shared between both, so
+ * it only depends on stdint.h. All fields are little endian.
+ *
+ * A trace is a header followed by hdr.count fixed-size records. Blocks are
+ * named by ids instead of addresses. Ids are recycled once a block is freed,
+ * so hdr.ids is the largest number of blocks live at the same time and the
+ * replay can keep them in a flat array.
+ */
+#define ALLOC_TRACE_MAGIC    0x54434c41  // "ALCT"
+#define ALLOC_TRACE_VERSION  1
+
+enum alloc_trace_op {
+    ALLOC_TRACE_MALLOC   = 1,
+    ALLOC_TRACE_FREE     = 2,
+    ALLOC_TRACE_CALLOC   = 3,  // size is nmemb * size
+    ALLOC_TRACE_REALLOC  = 4,  // the block keeps its id
+    ALLOC_TRACE_MEMALIGN = 5,  // alignment is 1 << align_log2
+};
+
+struct alloc_trace_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t count;          // records following the header
+    uint32_t ids;            // ids are 0 .. ids - 1
+    uint32_t reserved;
+};
+
+struct alloc_trace_rec {
+    uint32_t delta_ns;       // time since the previous record, saturated
+    uint32_t id;
+    uint32_t size;           // 0 for free, saturated at 4 GiB - 1
+    uint8_t op;
+    uint8_t align_log2;
+    uint16_t reserved;
+};
+
+#endif /* BENCH_ALLOC_TRACE_H */
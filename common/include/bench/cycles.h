@@ -0,0 +1,32 @@
+#ifndef BENCH_CYCLES_H
+#define BENCH_CYCLES_H
+
+#include <stdint.h>
+
+/*
+ * Raw CPU cycle counter (TSC on x86_64, virtual counter on arm64).
+ * Safe to call before ukplat_time_init(), which makes it usable from
+ * the earliest boot hooks where ukplat_monotonic_clock() still reads 0.
+ */
+static inline uint64_t bench_cycles(void) {
+#if defined(__x86_64__)
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t v;
+
+    __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+#error "bench_cycles() is not implemented for this architecture"
+#endif
+}
+
+// Counter frequency in Hz, calibrated against the platform clock on first use
+uint64_t bench_cycles_freq(void);
+
+uint64_t bench_cycles_to_ns(uint64_t cycles);
+
+#endif /* BENCH_CYCLES_H */
@@ -0,0 +1,23 @@
+#ifndef BENCH_FINISH_H
+#define BENCH_FINISH_H
+
+#include <uk/essentials.h>
+
+/*
+ * Result codes passed to bench_finish(), must fit in 0..127. Like
+ * Unikraft's own tests (cpu_native.c) they avoid 0 and 1, so that QEMU's
+ * status 1 for a failed start cannot pass for a result.
+ */
+#define BENCH_EXIT_OK       41
+#define BENCH_EXIT_FAIL     42
+
+/*
+ * Flush the console and power off the guest. On QEMU with
+ *   -device isa-debug-exit,iobase=0x501,iosize=0x04
+ * the VMM exits with status (result << 1) | 1, so the harness can tell
+ * how the benchmark ended without scraping the console. Without that
+ * device we fall back to a regular platform shutdown.
+ */
+void bench_finish(int result) __noreturn;
+
+#endif /* BENCH_FINISH_H */
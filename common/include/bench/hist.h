@@ -0,0 +1,60 @@
+#ifndef BENCH_HIST_H
+#define BENCH_HIST_H
+
+#include <stdint.h>
+
+/*
+ * Log-linear latency histogram in the style of HdrHistogram. Values below
+ * 2 * BENCH_HIST_SUB are counted exactly; above that every power of two is
+ * split into BENCH_HIST_SUB linear sub-buckets, so a recorded value is
+ * off by at most 1 / BENCH_HIST_SUB (~3%) over the full 64-bit range.
+ *
+ * Values are recorded in raw cycles (see bench/cycles.h) to keep the hot
+ * path to a few instructions; bench_hist_print() converts to ns.
+ */
+#define BENCH_HIST_SUB_BITS 5
+#define BENCH_HIST_SUB      (1 << BENCH_HIST_SUB_BITS)
+#define BENCH_HIST_BUCKETS  ((64 - BENCH_HIST_SUB_BITS + 1) * BENCH_HIST_SUB)
+
+struct bench_hist {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint64_t buckets[BENCH_HIST_BUCKETS];
+};
+
+static inline unsigned int bench_hist_index(uint64_t v) {
+    unsigned int shift;
+
+    if (v < 2 * BENCH_HIST_SUB)
+        return v;
+    shift = 63 - __builtin_clzll(v) - BENCH_HIST_SUB_BITS;
+    return shift * BENCH_HIST_SUB + (unsigned int)(v >> shift);
+}
+
+static inline void bench_hist_record(struct bench_hist *h, uint64_t v) {
+    h->buckets[bench_hist_index(v)]++;
+    if (!h->count || v < h->min)
+        h->min = v;
+    if (v > h->max)
+        h->max = v;
+    h->sum += v;
+    h->count++;
+}
+
+void bench_hist_reset(struct bench_hist *h);
+
+// Adds the values recorded in from to to
+void bench_hist_merge(struct bench_hist *to, const struct bench_hist *from);
+
+// Value at the given quantile in parts per thousand (999 == p99.9), in cycles
+uint64_t bench_hist_percentile(const struct bench_hist *h, unsigned int permille);
+
+/*
+ * Print one line for the parser:
+ *   LAT_HIST: <name> count=N min=.. avg=.. p50=.. p90=.. p99=.. p99.9=.. max=.. ns
+ */
+void bench_hist_print(const struct bench_hist *h, const char *name);
+
+#endif /* BENCH_HIST_H */
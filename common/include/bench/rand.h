@@ -0,0 +1,30 @@
+#ifndef BENCH_RAND_H
+#define BENCH_RAND_H
+
+#include <stdint.h>
+
+/*
+ * xorshift64* generator for workload generation. Not cryptographic, but
+ * cheap, reproducible for a given seed and without hidden global state,
+ * so every thread can own one. The state must not be 0.
+ */
+static inline uint64_t bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, n) for n < 2^32, without a division
+static inline uint32_t bench_rand_below(uint64_t *state, uint32_t n) {
+    return (uint32_t)(((bench_rand(state) >> 32) * n) >> 32);
+}
+
+static inline void bench_rand_seed(uint64_t *state, uint64_t seed) {
+    *state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+#endif /* BENCH_RAND_H */
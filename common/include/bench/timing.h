@@ -0,0 +1,82 @@
+#ifndef BENCH_TIMING_H
+#define BENCH_TIMING_H
+
+#include <stdint.h>
+
+/*
+ * Serialized cycle counter reads for timing operations of a few dozen
+ * cycles. bench_cycles() may be reordered with the code it measures;
+ * bench_timing_start() waits for everything before it and
+ * bench_timing_stop() for everything inside the measured region:
+ *
+ *   t0 = bench_timing_start();
+ *   ret = op();
+ *   bench_keep(ret);
+ *   cycles = bench_timing_net(bench_timing_stop() - t0);
+ *
+ * Call bench_timing_init() once before the first measurement.
+ */
+
+// Set by bench_timing_init()
+extern int bench_timing_rdtscp;
+extern uint64_t bench_timing_overhead_cycles;
+
+static inline uint64_t bench_timing_start(void) {
+#if defined(__x86_64__)
+    uint32_t lo, hi;
+
+    __asm__ __volatile__("lfence\n\trdtsc\n\tlfence"
+                         : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t v;
+
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb"
+                         : "=r"(v) : : "memory");
+    return v;
+#else
+#error "bench_timing_start() is not implemented for this architecture"
+#endif
+}
+
+static inline uint64_t bench_timing_stop(void) {
+#if defined(__x86_64__)
+    uint32_t lo, hi;
+
+    // rdtscp waits for earlier instructions; the lfence keeps later ones out
+    if (bench_timing_rdtscp)
+        __asm__ __volatile__("rdtscp\n\tlfence"
+                             : "=a"(lo), "=d"(hi) : : "rcx", "memory");
+    else
+        __asm__ __volatile__("lfence\n\trdtsc\n\tlfence"
+                             : "=a"(lo), "=d"(hi) : : "memory");
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t v;
+
+    __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb"
+                         : "=r"(v) : : "memory");
+    return v;
+#endif
+}
+
+// Makes v look used, so the computation of v cannot be elided or sunk
+// past bench_timing_stop()
+#define bench_keep(v) __asm__ __volatile__("" : : "r"(v) : "memory")
+
+/*
+ * Calibrate the counter against the platform clock, detect rdtscp and
+ * measure the harness overhead: the minimum cost of timing an empty
+ * out-of-line call, so that subtracting it never pushes a real
+ * measurement below zero. Prints one line for the parser:
+ *   BENCH_TIMING: freq=<Hz> overhead=<cycles> overhead_ns=<ns> stop=rdtscp|lfence
+ */
+void bench_timing_init(void);
+
+// A measured interval minus the harness overhead, at least 0
+static inline uint64_t bench_timing_net(uint64_t cycles) {
+    return cycles > bench_timing_overhead_cycles
+           ? cycles - bench_timing_overhead_cycles : 0;
+}
+
+#endif /* BENCH_TIMING_H */
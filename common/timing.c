@@ -0,0 +1,59 @@
+#include <stdio.h>
+#include <inttypes.h>
+#include <bench/cycles.h>
+#include <bench/timing.h>
+
+#define OVERHEAD_SAMPLES 10000
+
+int bench_timing_rdtscp;
+uint64_t bench_timing_overhead_cycles;
+
+static int has_rdtscp(void) {
+#if defined(__x86_64__)
+    uint32_t eax = 0x80000000, ebx, ecx, edx;
+
+    __asm__ __volatile__("cpuid"
+                         : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    if (eax < 0x80000001)
+        return 0;
+    eax = 0x80000001;
+    __asm__ __volatile__("cpuid"
+                         : "+a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx));
+    return !!(edx & (1u << 27));
+#else
+    return 0;
+#endif
+}
+
+static __attribute__((noinline)) long empty_call(void) {
+    return 0;
+}
+
+// Called through a pointer the compiler cannot see through, like an op
+static long (*volatile empty_op)(void) = empty_call;
+
+static uint64_t measure_overhead(void) {
+    uint64_t t0, t, min = UINT64_MAX;
+    long ret;
+
+    for (unsigned int i = 0; i < OVERHEAD_SAMPLES; i++) {
+        t0 = bench_timing_start();
+        ret = empty_op();
+        bench_keep(ret);
+        t = bench_timing_stop() - t0;
+        if (t < min)
+            min = t;
+    }
+    return min;
+}
+
+void bench_timing_init(void) {
+    bench_timing_rdtscp = has_rdtscp();
+    bench_timing_overhead_cycles = measure_overhead();
+
+    printf("BENCH_TIMING: freq=%" PRIu64 " overhead=%" PRIu64
+           " overhead_ns=%" PRIu64 " stop=%s\n",
+           bench_cycles_freq(), bench_timing_overhead_cycles,
+           bench_cycles_to_ns(bench_timing_overhead_cycles),
+           bench_timing_rdtscp ? "rdtscp" : "lfence");
+}
@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+"""
+Allocator backend matrix for benchmark-malloc.
+
+Builds benchmark-malloc once per heap backend (profiles/alloc/<backend>.yaml
+stacked on a build profile), runs every image through the same list of
+workloads (guest command lines, see README "Runtime parameters") and prints
+a comparison table of throughput, malloc/free latency percentiles and peak
+heap footprint. The table is also written to results/alloc_matrix.csv.
+"""
+import argparse
+import csv
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+
+from boot_e2e import BENCH_EXIT_OK, guest_result, qemu_cmd
+
+ROOT_DIR = os.path.join(os.path.dirname(os.path.realpath(__file__)), "..")
+BENCH = "benchmark-malloc"
+
+OPS_RE = re.compile(r"MALLOC_OPS: (\d+)")
+PEAK_RE = re.compile(r"MALLOC_PEAK_KB: (\d+)")
+HIST_RE = re.compile(r"LAT_HIST: (\S+) count=\d+ (.*) ns")
+
+COLUMNS = ["ops", "malloc_p50", "malloc_p99", "malloc_p99.9",
+           "free_p50", "free_p99", "free_p99.9", "peak_kb"]
+
+
+def build(profile, backend):
+    """Builds one variant and returns the path of its kernel image."""
+    bench_dir = os.path.join(ROOT_DIR, BENCH)
+    kraftfile = subprocess.run(
+        [sys.executable, os.path.join(ROOT_DIR, "scripts", "profile.py"),
+         bench_dir, profile, f"alloc/{backend}"],
+        check=True, stdout=subprocess.PIPE, text=True).stdout.strip()
+    subprocess.run(["kraft", "build", "-K", os.path.basename(kraftfile)],
+                   cwd=bench_dir, check=True)
+
+    # Every variant builds into the same tree, keep a copy of each image
+    image = os.path.join(bench_dir, "build", f"alloc-{backend}.elf")
+    os.makedirs(os.path.dirname(image), exist_ok=True)
+    shutil.copy(os.path.join(bench_dir, ".unikraft", "build",
+                             f"{BENCH}_qemu-x86_64"), image)
+    return image
+
+
+def run_once(args):
+    """Returns {column: value} of one run, or None if the guest failed."""
+    try:
+        proc = subprocess.run(qemu_cmd(args), stdin=subprocess.DEVNULL,
+                              stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                              timeout=args.timeout)
+    except subprocess.TimeoutExpired:
+        return None
+    out = proc.stdout.decode(errors="replace")
+    ops = OPS_RE.search(out)
+    if guest_result(proc.returncode) != BENCH_EXIT_OK or not ops:
+        return None
+
+    res = {"ops": int(ops.group(1))}
+    for match in HIST_RE.finditer(out):
+        fields = dict(re.findall(r"(\S+)=(\d+)", match.group(2)))
+        for pct in ("p50", "p99", "p99.9"):
+            res[f"{match.group(1)}_{pct}"] = int(fields[pct])
+    peak = PEAK_RE.search(out)
+    if peak:
+        res["peak_kb"] = int(peak.group(1))
+    return res
+
+
+def fmt(value):
+    return "-" if value is None else str(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--backends",
+                        default="bbuddy,region,tlsf,tinyalloc,mimalloc")
+    parser.add_argument("--workloads",
+                        default="malloc.size=16;malloc.size=256;"
+                                "malloc.size=4096",
+                        help="semicolon-separated guest command lines")
+    parser.add_argument("--profile", default="release",
+                        help="build profile the backends are stacked on")
+    parser.add_argument("--no-build", action="store_true",
+                        help="reuse build/alloc-<backend>.elf")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("-m", "--memory", default="512M")
+    parser.add_argument("--kvm", action="store_true")
+    parser.add_argument("-n", "--runs", type=int, default=3)
+    parser.add_argument("--timeout", type=float, default=120.0)
+    parser.add_argument("--csv", default="results/alloc_matrix.csv")
+    parser.add_argument("qemu_args", nargs="*",
+                        help="extra QEMU arguments (after --)")
+    args = parser.parse_args()
+
+    backends = args.backends.split(",")
+    workloads = [w.strip() for w in args.workloads.split(";") if w.strip()]
+
+    images = {}
+    for backend in backends:
+        image = os.path.join(ROOT_DIR, BENCH, "build", f"alloc-{backend}.elf")
+        if not args.no_build:
+            print(f"🛠 Building {BENCH} with {backend}...")
+            try:
+                image = build(args.profile, backend)
+            except subprocess.CalledProcessError:
+                print(f"❌ Build failed for {backend}")
+                continue
+        if os.path.exists(image):
+            images[backend] = image
+        else:
+            print(f"[!] No image for {backend}: {image}")
+
+    rows = []
+    for workload in workloads:
+        print(f"\n### {workload}\n")
+        print("| backend | " + " | ".join(COLUMNS) + " |")
+        print("|---" * (len(COLUMNS) + 1) + "|")
+        for backend, image in images.items():
+            args.kernel = image
+            args.append = f"{workload} --"
+            runs = [r for r in (run_once(args) for _ in range(args.runs)) if r]
+            row = {"workload": workload, "backend": backend}
+            for col in COLUMNS:
+                values = [r[col] for r in runs if col in r]
+                row[col] = int(statistics.median(values)) if values else None
+            rows.append(row)
+            print(f"| {backend} | "
+                  + " | ".join(fmt(row[c]) for c in COLUMNS) + " |"
+                  + ("" if runs else "  ❌ no successful run"))
+
+    if not rows:
+        return 1
+
+    os.makedirs(os.path.dirname(args.csv) or ".", exist_ok=True)
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["workload", "backend"] + COLUMNS)
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"\n✅ Allocator matrix saved to '{args.csv}'")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,381 @@
+/*
+ * LD_PRELOAD allocation recorder for glibc programs, producing the trace
+ * format of common/include/bench/alloc_trace.h. Use it via
+ * scripts/record_trace.sh, which builds and preloads it:
+ *
+ *   ./scripts/record_trace.sh trace.bin -- ./my_program args...
+ *
+ * The wrappers forward to glibc's __libc_* entry points, so no dlsym() is
+ * needed while the allocator is being resolved. Allocations made before
+ * the constructor runs, or from the recorder itself, are not recorded and
+ * their frees are skipped.
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#include <bench/alloc_trace.h>
+
+extern void *__libc_malloc(size_t size);
+extern void __libc_free(void *ptr);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t align, size_t size);
+
+#define BUF_RECS    4096
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread int in_hook;
+static int fd = -1;
+static struct alloc_trace_header hdr;
+static struct alloc_trace_rec buf[BUF_RECS];
+static unsigned int nbuf;
+static uint64_t last_ns;
+
+// Open addressing map from block address to id, linear probing
+struct slot {
+    uintptr_t addr;  // 0 if empty
+    uint32_t id;
+};
+
+static struct slot *map;
+static size_t map_cap, map_used;
+// Ids of freed blocks, reused before new ones are handed out
+static uint32_t *free_ids;
+static size_t free_cap, free_used;
+
+// The recorder's own memory must not go through the hooked allocator
+static void *grow(void *old, size_t old_size, size_t new_size) {
+    void *p = mmap(NULL, new_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED)
+        return NULL;
+    if (old) {
+        memcpy(p, old, old_size);
+        munmap(old, old_size);
+    }
+    return p;
+}
+
+static inline size_t hash(uintptr_t addr, size_t cap) {
+    return (addr >> 4) * 0x9E3779B97F4A7C15ULL & (cap - 1);
+}
+
+static int map_put(uintptr_t addr, uint32_t id);
+
+static int map_resize(void) {
+    struct slot *old = map;
+    size_t old_cap = map_cap;
+
+    map_cap = old_cap ? 2 * old_cap : 1 << 16;
+    map = grow(NULL, 0, map_cap * sizeof(*map));
+    if (!map)
+        return -1;
+    map_used = 0;
+    for (size_t i = 0; i < old_cap; i++)
+        if (old[i].addr)
+            map_put(old[i].addr, old[i].id);
+    if (old)
+        munmap(old, old_cap * sizeof(*old));
+    return 0;
+}
+
+static int map_put(uintptr_t addr, uint32_t id) {
+    size_t i;
+
+    if (2 * (map_used + 1) > map_cap && map_resize())
+        return -1;
+    for (i = hash(addr, map_cap); map[i].addr; i = (i + 1) & (map_cap - 1))
+        ;
+    map[i].addr = addr;
+    map[i].id = id;
+    map_used++;
+    return 0;
+}
+
+// Removes addr and returns its id, or -1 if it was not recorded
+static int64_t map_take(uintptr_t addr) {
+    size_t i, j, k;
+    uint32_t id;
+
+    if (!map_cap)
+        return -1;
+    for (i = hash(addr, map_cap); map[i].addr != addr;
+         i = (i + 1) & (map_cap - 1))
+        if (!map[i].addr)
+            return -1;
+    id = map[i].id;
+
+    // Backward shift deletion, so that no tombstones are needed
+    for (j = (i + 1) & (map_cap - 1); map[j].addr;
+         j = (j + 1) & (map_cap - 1)) {
+        k = hash(map[j].addr, map_cap);
+        if ((j > i && (k <= i || k > j)) || (j < i && k <= i && k > j)) {
+            map[i] = map[j];
+            i = j;
+        }
+    }
+    map[i].addr = 0;
+    map_used--;
+    return id;
+}
+
+static int64_t new_id(void) {
+    if (free_used)
+        return free_ids[--free_used];
+    return hdr.ids++;
+}
+
+static void release_id(uint32_t id) {
+    if (free_used == free_cap) {
+        size_t cap = free_cap ? 2 * free_cap : 1 << 14;
+        uint32_t *p = grow(free_ids, free_cap * sizeof(*p), cap * sizeof(*p));
+
+        // Losing an id only makes the replay array a bit larger
+        if (!p)
+            return;
+        free_ids = p;
+        free_cap = cap;
+    }
+    free_ids[free_used++] = id;
+}
+
+static void flush(void) {
+    size_t len = nbuf * sizeof(*buf);
+    const char *p = (const char *)buf;
+    ssize_t n;
+
+    while (len) {
+        n = write(fd, p, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            close(fd);
+            fd = -1;
+            break;
+        }
+        p += n;
+        len -= n;
+    }
+    nbuf = 0;
+}
+
+static void emit(uint8_t op, uint32_t id, size_t size, size_t align) {
+    struct alloc_trace_rec *r = &buf[nbuf];
+    struct timespec ts;
+    uint64_t now, delta;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    delta = last_ns ? now - last_ns : 0;
+    last_ns = now;
+
+    r->delta_ns = delta > UINT32_MAX ? UINT32_MAX : delta;
+    r->id = id;
+    r->size = size > UINT32_MAX ? UINT32_MAX : size;
+    r->op = op;
+    // Rounded up, as glibc does for alignments that are no power of two
+    r->align_log2 = align > 1 ? 64 - __builtin_clzl(align - 1) : 0;
+    r->reserved = 0;
+    hdr.count++;
+    if (++nbuf == BUF_RECS)
+        flush();
+}
+
+/*
+ * Records the free of old (if set) or the allocation of new. A free must
+ * be recorded while the block is still owned: once it is handed back,
+ * another thread may get the same address and record it first.
+ */
+static void record(uint8_t op, void *old, void *new, size_t size,
+                   size_t align) {
+    int64_t id;
+
+    if (in_hook)
+        return;
+    in_hook = 1;
+    pthread_mutex_lock(&lock);
+    if (fd < 0)
+        goto out;
+
+    if (old) {
+        id = map_take((uintptr_t)old);
+        if (id >= 0) {
+            emit(ALLOC_TRACE_FREE, id, 0, 0);
+            release_id(id);
+        }
+        goto out;
+    }
+    id = new_id();
+    if (!map_put((uintptr_t)new, id))
+        emit(op, id, size, align);
+out:
+    pthread_mutex_unlock(&lock);
+    in_hook = 0;
+}
+
+/*
+ * realloc() frees the old block if it moves it, so, as for free(), the old
+ * address leaves the map before the call. Returns the block's id, or -1
+ * if it is not recorded.
+ */
+static int64_t realloc_begin(void *old) {
+    int64_t id = -1;
+
+    if (in_hook)
+        return -1;
+    in_hook = 1;
+    pthread_mutex_lock(&lock);
+    if (fd >= 0)
+        id = map_take((uintptr_t)old);
+    pthread_mutex_unlock(&lock);
+    in_hook = 0;
+    return id;
+}
+
+// Maps id to the moved block, or back to old if realloc() failed
+static void realloc_end(int64_t id, void *old, void *new, size_t size) {
+    if (id < 0 || in_hook)
+        return;
+    in_hook = 1;
+    pthread_mutex_lock(&lock);
+    if (fd >= 0 && !map_put((uintptr_t)(new ? new : old), id) && new)
+        emit(ALLOC_TRACE_REALLOC, id, size, 0);
+    pthread_mutex_unlock(&lock);
+    in_hook = 0;
+}
+
+void *malloc(size_t size) {
+    void *p = __libc_malloc(size);
+
+    if (p)
+        record(ALLOC_TRACE_MALLOC, NULL, p, size, 0);
+    return p;
+}
+
+void free(void *ptr) {
+    if (ptr)
+        record(ALLOC_TRACE_FREE, ptr, NULL, 0, 0);
+    __libc_free(ptr);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    void *p = __libc_calloc(nmemb, size);
+
+    if (p)
+        record(ALLOC_TRACE_CALLOC, NULL, p, nmemb * size, 0);
+    return p;
+}
+
+void *realloc(void *ptr, size_t size) {
+    int64_t id;
+    void *p;
+
+    if (!ptr)
+        return malloc(size);
+    if (!size) {
+        free(ptr);
+        return NULL;
+    }
+    id = realloc_begin(ptr);
+    p = __libc_realloc(ptr, size);
+    realloc_end(id, ptr, p, size);
+    return p;
+}
+
+void *memalign(size_t align, size_t size) {
+    void *p = __libc_memalign(align, size);
+
+    if (p)
+        record(ALLOC_TRACE_MEMALIGN, NULL, p, size, align);
+    return p;
+}
+
+void *aligned_alloc(size_t align, size_t size) {
+    return memalign(align, size);
+}
+
+int posix_memalign(void **memptr, size_t align, size_t size) {
+    void *p;
+
+    if (!align || (align & (align - 1)) || align % sizeof(void *))
+        return EINVAL;
+    p = memalign(align, size);
+    if (!p)
+        return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+
+void *valloc(size_t size) {
+    return memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+/*
+ * fork() copies the lock in whatever state another thread holds it, so
+ * it is held across the fork. A forked child must not append to the
+ * parent's trace.
+ */
+static void trace_fork_prepare(void) {
+    pthread_mutex_lock(&lock);
+}
+
+static void trace_fork_parent(void) {
+    pthread_mutex_unlock(&lock);
+}
+
+static void trace_fork_child(void) {
+    if (fd >= 0)
+        close(fd);
+    fd = -1;
+    nbuf = 0;
+    pthread_mutex_unlock(&lock);
+}
+
+__attribute__((constructor)) static void trace_open(void) {
+    const char *path = getenv("ALLOC_TRACE_OUT");
+
+    if (!path)
+        return;
+    // Only the first process is traced, programs it executes would
+    // otherwise truncate the file
+    path = strdup(path);
+    unsetenv("ALLOC_TRACE_OUT");
+    pthread_atfork(trace_fork_prepare, trace_fork_parent, trace_fork_child);
+    pthread_mutex_lock(&lock);
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd >= 0) {
+        hdr.magic = ALLOC_TRACE_MAGIC;
+        hdr.version = ALLOC_TRACE_VERSION;
+        // Rewritten with the final counts on exit
+        if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr)) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    if (fd < 0)
+        fprintf(stderr, "alloc_trace: cannot write %s\n", path);
+}
+
+__attribute__((destructor)) static void trace_close(void) {
+    pthread_mutex_lock(&lock);
+    if (fd >= 0) {
+        flush();
+        if (fd >= 0 && pwrite(fd, &hdr, sizeof(hdr), 0) != sizeof(hdr))
+            fprintf(stderr, "alloc_trace: cannot finish the trace\n");
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+"""
+Boot-density benchmark.
+
+Starts N instances of the boot image at once, for every N in --instances,
+and records per guest the host-side boot latency (QEMU exec until the
+BOOT_TIME marker), the guest-internal BOOT_TIME and the peak RSS/PSS of its
+QEMU process from /proc/<pid>/smaps_rollup. Reports p50/p99 boot latency
+and memory per instance for each concurrency level.
+"""
+import argparse
+import csv
+import math
+import os
+import re
+import subprocess
+import threading
+import time
+
+from boot_e2e import qemu_cmd
+
+SAMPLE_INTERVAL = 0.05
+
+
+def percentile(values, pct):
+    """Nearest-rank percentile, values need not be sorted."""
+    if not values:
+        return float("nan")
+    ordered = sorted(values)
+    rank = max(1, math.ceil(pct / 100.0 * len(ordered)))
+    return ordered[rank - 1]
+
+
+def read_mem_kb(pid):
+    """Returns (rss_kb, pss_kb) of a process, or None once it is gone."""
+    rss = pss = 0
+    try:
+        with open(f"/proc/{pid}/smaps_rollup") as f:
+            for line in f:
+                if line.startswith("Rss:"):
+                    rss = int(line.split()[1])
+                elif line.startswith("Pss:"):
+                    pss = int(line.split()[1])
+    except (FileNotFoundError, ProcessLookupError, PermissionError):
+        return None
+    return rss, pss
+
+
+class Guest:
+    def __init__(self, args):
+        self.args = args
+        self.proc = None
+        self.start_ns = None
+        self.boot_ms = None
+        self.guest_ms = None
+        self.rss_kb = 0
+        self.pss_kb = 0
+        self.lock = threading.Lock()
+
+    def sample(self):
+        mem = read_mem_kb(self.proc.pid)
+        if mem:
+            with self.lock:
+                self.rss_kb = max(self.rss_kb, mem[0])
+                self.pss_kb = max(self.pss_kb, mem[1])
+
+    def start(self):
+        self.start_ns = time.monotonic_ns()
+        self.proc = subprocess.Popen(qemu_cmd(self.args),
+                                     stdin=subprocess.DEVNULL,
+                                     stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT)
+
+    def watch(self):
+        marker = self.args.marker.encode()
+        for line in self.proc.stdout:
+            if marker in line and self.boot_ms is None:
+                self.boot_ms = (time.monotonic_ns() - self.start_ns) / 1e6
+                # The guest is fully up here; grab its memory before it exits
+                self.sample()
+                match = re.search(rb"BOOT_TIME: ([0-9.]+)", line)
+                if match:
+                    self.guest_ms = float(match.group(1))
+        self.proc.wait()
+
+
+def run_level(args, n):
+    guests = [Guest(args) for _ in range(n)]
+    # Launch all QEMUs back-to-back first, then attach readers, so that the
+    # instances really boot concurrently
+    for g in guests:
+        g.start()
+    readers = [threading.Thread(target=g.watch, daemon=True) for g in guests]
+    for r in readers:
+        r.start()
+
+    deadline = time.monotonic() + args.timeout
+    while any(r.is_alive() for r in readers):
+        for g in guests:
+            if g.proc.poll() is None:
+                g.sample()
+        if time.monotonic() > deadline:
+            for g in guests:
+                if g.proc.poll() is None:
+                    g.proc.kill()
+        time.sleep(SAMPLE_INTERVAL)
+    for r in readers:
+        r.join()
+
+    booted = [g for g in guests if g.boot_ms is not None]
+    boot = [g.boot_ms for g in booted]
+    guest = [g.guest_ms for g in booted if g.guest_ms is not None]
+    rss = [g.rss_kb for g in guests if g.rss_kb]
+    pss = [g.pss_kb for g in guests if g.pss_kb]
+    return {
+        "instances": n,
+        "failed": n - len(booted),
+        "boot_p50_ms": percentile(boot, 50),
+        "boot_p99_ms": percentile(boot, 99),
+        "boot_max_ms": max(boot) if boot else float("nan"),
+        "guest_p50_ms": percentile(guest, 50),
+        "guest_p99_ms": percentile(guest, 99),
+        "rss_p50_kb": percentile(rss, 50),
+        "pss_p50_kb": percentile(pss, 50),
+        "pss_total_mb": sum(pss) / 1024.0,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--kernel", default="benchmark-boot/build/boot.elf")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("-m", "--memory", default="64M")
+    parser.add_argument("--append", default="", help="guest command line")
+    parser.add_argument("--kvm", action="store_true")
+    parser.add_argument("--marker", default="BOOT_TIME:")
+    parser.add_argument("--instances", default="1,10,100,500",
+                        help="comma-separated concurrency levels")
+    parser.add_argument("--timeout", type=float, default=120.0,
+                        help="per level, in seconds")
+    parser.add_argument("--csv", default="results/boot_density.csv")
+    parser.add_argument("qemu_args", nargs="*",
+                        help="extra QEMU arguments (after --)")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.kernel):
+        parser.error(f"kernel image not found: {args.kernel}")
+
+    rows = []
+    for n in (int(x) for x in args.instances.split(",")):
+        print(f"[*] Booting {n} instance(s) concurrently...")
+        row = run_level(args, n)
+        rows.append(row)
+        print(f"DENSITY: n={n} failed={row['failed']} "
+              f"boot_p50={row['boot_p50_ms']:.3f}ms "
+              f"boot_p99={row['boot_p99_ms']:.3f}ms "
+              f"guest_p50={row['guest_p50_ms']:.3f}ms "
+              f"rss_p50={row['rss_p50_kb']:.0f}kB "
+              f"pss_p50={row['pss_p50_kb']:.0f}kB "
+              f"pss_total={row['pss_total_mb']:.1f}MB")
+
+    os.makedirs(os.path.dirname(args.csv) or ".", exist_ok=True)
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()))
+        writer.writeheader()
+        writer.writerows(rows)
+    print(f"✅ Density results saved to '{args.csv}'")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""
+Host-side end-to-end boot latency.
+
+Timestamps the QEMU fork/exec on the host and then either the arrival of a
+guest marker on the serial console (default: the BOOT_TIME line printed by
+benchmark-boot) or the exit of QEMU through isa-debug-exit / ACPI poweroff
+(--exit). The total VMM-plus-guest cold start is reported next to the
+guest-internal BOOT_TIME.
+"""
+import argparse
+import os
+import re
+import statistics
+import subprocess
+import threading
+import time
+
+ISA_DEBUG_EXIT = ["-device", "isa-debug-exit,iobase=0x501,iosize=0x04"]
+
+# Result codes of bench_finish(), see common/include/bench/finish.h
+BENCH_EXIT_OK = 41
+BENCH_EXIT_FAIL = 42
+
+
+def qemu_cmd(args):
+    cmd = [args.qemu, "-kernel", args.kernel, "-m", args.memory,
+           "-display", "none", "-serial", "stdio", "-monitor", "none",
+           "-no-reboot"] + ISA_DEBUG_EXIT
+    if args.kvm:
+        cmd += ["-enable-kvm", "-cpu", "host"]
+    if args.append:
+        cmd += ["-append", args.append]
+    return cmd + args.qemu_args
+
+
+def guest_result(returncode):
+    """Decodes QEMU's exit status into the code the guest passed to
+    bench_finish(), or None if the guest never reported one."""
+    # isa-debug-exit makes QEMU exit with (code << 1) | 1
+    if returncode in ((BENCH_EXIT_OK << 1) | 1, (BENCH_EXIT_FAIL << 1) | 1):
+        return returncode >> 1
+    return None
+
+
+def run_once(args):
+    marker = args.marker.encode()
+    guest_ms = None
+    marker_ns = None
+
+    start_ns = time.monotonic_ns()
+    proc = subprocess.Popen(qemu_cmd(args), stdin=subprocess.DEVNULL,
+                            stdout=subprocess.PIPE,
+                            stderr=subprocess.STDOUT)
+    # Hung guests never print the marker or exit; don't let them block us
+    timed_out = threading.Event()
+
+    def expire():
+        timed_out.set()
+        proc.kill()
+
+    watchdog = threading.Timer(args.timeout, expire)
+    watchdog.start()
+    try:
+        for line in proc.stdout:
+            if marker in line and marker_ns is None:
+                marker_ns = time.monotonic_ns()
+                match = re.search(rb"BOOT_TIME: ([0-9.]+)", line)
+                if match:
+                    guest_ms = float(match.group(1))
+                if not args.exit:
+                    break
+        if not args.exit:
+            # The marker ends the measurement, the guest may keep running
+            proc.kill()
+        proc.wait()
+    finally:
+        watchdog.cancel()
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait()
+    end_ns = time.monotonic_ns()
+
+    # A marker that arrived counts even if the watchdog fired afterwards
+    if not args.exit and marker_ns is not None:
+        total_ns = marker_ns - start_ns
+    elif args.exit and not timed_out.is_set():
+        total_ns = end_ns - start_ns
+    else:
+        return None
+
+    return {
+        "total_ms": total_ns / 1e6,
+        "guest_ms": guest_ms,
+        "exit_code": guest_result(proc.returncode) if args.exit else None,
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--kernel", default="benchmark-boot/build/boot.elf")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("-m", "--memory", default="64M")
+    parser.add_argument("--append", default="", help="guest command line")
+    parser.add_argument("--kvm", action="store_true")
+    parser.add_argument("--marker", default="BOOT_TIME:",
+                        help="serial line that ends the measurement")
+    parser.add_argument("--exit", action="store_true",
+                        help="measure until QEMU exits instead of the marker")
+    parser.add_argument("-n", "--runs", type=int, default=10)
+    parser.add_argument("--timeout", type=float, default=30.0)
+    parser.add_argument("qemu_args", nargs="*",
+                        help="extra QEMU arguments (after --)")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.kernel):
+        parser.error(f"kernel image not found: {args.kernel}")
+
+    totals = []
+    guests = []
+    for i in range(args.runs):
+        res = run_once(args)
+        if res is None:
+            print(f"[!] run {i}: timed out or marker '{args.marker}' not seen")
+            continue
+        totals.append(res["total_ms"])
+        guest = res["guest_ms"]
+        if guest is not None:
+            guests.append(guest)
+        print(f"run {i}: total {res['total_ms']:.3f} ms, guest "
+              f"{guest if guest is not None else '-'} ms"
+              + (f", exit {res['exit_code']}" if args.exit else ""))
+
+    if not totals:
+        return 1
+
+    total = statistics.median(totals)
+    print(f"BOOT_E2E_TIME: {total:.3f}")
+    if guests:
+        guest = statistics.median(guests)
+        print(f"BOOT_TIME: {guest:.3f}")
+        print(f"BOOT_VMM_OVERHEAD: {total - guest:.3f}")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""
+Guest memory-size sweep for the boot benchmark.
+
+Boots the image (built with CONFIG_APPBENCHMARKBOOT_TIMELINE) at every
+memory size in --sizes, collects the BOOT_PHASE breakdown of each run and
+plots the median time of every significant phase against guest RAM. Heap
+initialization by the allocator shows up in the phase ending at
+inittab.1.0.
+"""
+import argparse
+import csv
+import os
+import re
+import statistics
+import subprocess
+import time
+from collections import defaultdict
+
+from boot_e2e import qemu_cmd
+
+PHASE_RE = re.compile(r"BOOT_PHASE: (\S+) (\d+) ns")
+TOTAL_RE = re.compile(r"BOOT_PHASE_TOTAL: (\d+) ns")
+
+
+def size_mb(size):
+    size = size.upper()
+    if size.endswith("G"):
+        return int(size[:-1]) * 1024
+    return int(size.rstrip("M"))
+
+
+def run_once(args):
+    """Returns ({phase: ns}, total_ns, host_ms) or None on failure."""
+    start_ns = time.monotonic_ns()
+    try:
+        out = subprocess.run(qemu_cmd(args), stdin=subprocess.DEVNULL,
+                             stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             timeout=args.timeout).stdout.decode(errors="replace")
+    except subprocess.TimeoutExpired:
+        return None
+    host_ms = (time.monotonic_ns() - start_ns) / 1e6
+
+    phases = defaultdict(int)
+    for match in PHASE_RE.finditer(out):
+        phases[match.group(1)] += int(match.group(2))
+    total = TOTAL_RE.search(out)
+    if not phases or not total:
+        return None
+    return phases, int(total.group(1)), host_ms
+
+
+def plot(rows, phases, path):
+    import matplotlib.pyplot as plt
+
+    sizes = sorted({r["memory_mb"] for r in rows})
+    plt.figure(figsize=(10, 6))
+    for phase in phases:
+        values = [next(r["ns"] for r in rows
+                       if r["memory_mb"] == s and r["phase"] == phase) / 1e6
+                  for s in sizes]
+        plt.plot(sizes, values, marker="o", label=phase)
+
+    plt.xscale("log", base=2)
+    plt.xticks(sizes, [f"{s}M" if s < 1024 else f"{s // 1024}G" for s in sizes])
+    plt.title("Unikraft boot phases vs. guest memory")
+    plt.xlabel("Guest memory")
+    plt.ylabel("Time (ms)")
+    plt.legend()
+    plt.grid(linestyle="--", alpha=0.7)
+    plt.tight_layout()
+    plt.savefig(path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--kernel", default="benchmark-boot/build/boot.elf")
+    parser.add_argument("--qemu", default="qemu-system-x86_64")
+    parser.add_argument("--sizes",
+                        default="16M,32M,64M,128M,256M,512M,1G,2G,4G")
+    parser.add_argument("--append", default="", help="guest command line")
+    parser.add_argument("--kvm", action="store_true")
+    parser.add_argument("-n", "--runs", type=int, default=5)
+    parser.add_argument("--timeout", type=float, default=60.0)
+    parser.add_argument("--min-share", type=float, default=0.02,
+                        help="only plot phases above this share of the boot")
+    parser.add_argument("--csv", default="results/boot_memsweep.csv")
+    parser.add_argument("--png", default="results/boot_memsweep.png")
+    parser.add_argument("qemu_args", nargs="*",
+                        help="extra QEMU arguments (after --)")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.kernel):
+        parser.error(f"kernel image not found: {args.kernel}")
+
+    rows = []
+    significant = set()
+    for size in args.sizes.split(","):
+        args.memory = size
+        runs = [r for r in (run_once(args) for _ in range(args.runs)) if r]
+        if not runs:
+            print(f"[!] -m {size}: no successful run")
+            continue
+
+        total = statistics.median(r[1] for r in runs)
+        host = statistics.median(r[2] for r in runs)
+        names = sorted({p for r in runs for p in r[0]})
+        for phase in names + ["total", "host_e2e"]:
+            if phase == "total":
+                ns = total
+            elif phase == "host_e2e":
+                ns = host * 1e6
+            else:
+                ns = statistics.median(r[0].get(phase, 0) for r in runs)
+                if ns >= args.min_share * total:
+                    significant.add(phase)
+            rows.append({"memory_mb": size_mb(size), "phase": phase,
+                         "ns": int(ns)})
+        print(f"BOOT_MEMSWEEP: {size} total={total / 1e6:.3f}ms "
+              f"host_e2e={host:.3f}ms ({len(runs)} runs)")
+
+    if not rows:
+        return 1
+
+    os.makedirs(os.path.dirname(args.csv) or ".", exist_ok=True)
+    with open(args.csv, "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["memory_mb", "phase", "ns"])
+        writer.writeheader()
+        writer.writerows(rows)
+
+    # Phases that are missing at some size (e.g. a failed run) count as 0
+    sizes = {r["memory_mb"] for r in rows}
+    for phase in sorted(significant) + ["total"]:
+        for s in sizes:
+            if not any(r["memory_mb"] == s and r["phase"] == phase
+                       for r in rows):
+                rows.append({"memory_mb": s, "phase": phase, "ns": 0})
+    plot(rows, sorted(significant) + ["total"], args.png)
+    print(f"✅ Sweep saved to '{args.csv}' and '{args.png}'")
+    return 0
+
+
+if __name__ == "__main__":
+    raise SystemExit(main())
@@ -0,0 +1,83 @@
+#!/bin/bash
+# Shared helpers for the measure_*.sh scripts, source from the repo root.
+
+QEMU=${QEMU:-qemu-system-x86_64}
+
+# Lets bench_finish() power off the guest with a result-encoded exit status
+QEMU_EXIT_DEVICE=(-device isa-debug-exit,iobase=0x501,iosize=0x04)
+
+# Result codes of bench_finish(), see common/include/bench/finish.h
+BENCH_EXIT_OK=41
+BENCH_EXIT_FAIL=42
+
+# The TCP server and client guests share a point-to-point link: a QEMU
+# socket netdev joins their virtio-net NICs. lwIP takes static addresses
+# from netdev.ip; the server's is the client's default tcp.server.
+TCP_LINK=${TCP_LINK:-127.0.0.1:12400}
+TCP_SERVER_IP="netdev.ip=10.0.2.2/24"
+TCP_CLIENT_IP="netdev.ip=10.0.2.15/24"
+
+# guest_result <qemu status>
+# QEMU exits with (code << 1) | 1 after an isa-debug-exit write. Prints 0 if
+# the benchmark passed, 1 if it failed and 2 if it never reported a result
+# (QEMU failed to start, the guest crashed or powered off on its own).
+guest_result() {
+  local status=$1
+
+  case $status in
+    $(( (BENCH_EXIT_OK << 1) | 1 ))) echo 0 ;;
+    $(( (BENCH_EXIT_FAIL << 1) | 1 ))) echo 1 ;;
+    *) echo 2 ;;
+  esac
+}
+
+# run_guest <kernel> [qemu args...]
+# Boots the image with its console on stdout and returns once the guest has
+# powered itself off. Returns the decoded benchmark result.
+run_guest() {
+  local kernel=$1
+  shift
+
+  "$QEMU" -kernel "$kernel" -nographic -no-reboot \
+    "${QEMU_EXIT_DEVICE[@]}" "$@" < /dev/null
+  return "$(guest_result $?)"
+}
+
+# wait_for_line <file> <pattern> <timeout in s>
+wait_for_line() {
+  local file=$1 pattern=$2 deadline=$((SECONDS + $3))
+
+  until grep -q "$pattern" "$file" 2> /dev/null; do
+    (( SECONDS >= deadline )) && return 1
+    sleep 0.05
+  done
+}
+
+# run_tcp_pair <server kernel> <client kernel> <server log> [guest args]
+# Boots the server with its console in the log, waits until it listens and
+# runs the client against it with its console on stdout. Both get the same
+# guest arguments (default "--"). Pairs that run at the same time need
+# their own TCP_LINK. Returns 0 only if both guests passed.
+run_tcp_pair() {
+  local server=$1 client=$2 server_log=$3 args=${4:---}
+  local pid result
+
+  run_guest "$server" -netdev "socket,id=n0,listen=$TCP_LINK" \
+    -device virtio-net-pci,netdev=n0 \
+    -append "$TCP_SERVER_IP $args" > "$server_log" &
+  pid=$!
+  if ! wait_for_line "$server_log" "TCP_SERVER_READY" 30; then
+    echo "[!] Server did not come up" >&2
+    kill "$pid"
+    return 2
+  fi
+
+  run_guest "$client" -netdev "socket,id=n0,connect=$TCP_LINK" \
+    -device virtio-net-pci,netdev=n0 -append "$TCP_CLIENT_IP $args"
+  result=$?
+  # A failed server fails the pair even if the client passed
+  if ! wait "$pid" && (( result == 0 )); then
+    result=1
+  fi
+  return "$result"
+}
@@ -1,7 +1,9 @@
 #!/bin/bash
 
+source "$(dirname "$0")/common.sh"
+
 echo "[*] Measuring malloc performance..."
 
-qemu-system-x86_64 -kernel benchmark-malloc/build/malloc.elf \
-  -nographic -serial mon:stdio | \
+run_guest benchmark-malloc/build/malloc.elf | \
   grep "MALLOC_OPS" | tee results/malloc_ops.txt
+exit "${PIPESTATUS[0]}"
@@ -1,7 +1,9 @@
 #!/bin/bash
 
+source "$(dirname "$0")/common.sh"
+
 echo "[*] Measuring syscall latency..."
 
-qemu-system-x86_64 -kernel benchmark-syscall/build/syscall.elf \
-  -nographic -serial mon:stdio | \
-  grep "SYSCALL_LATENCY" | tee results/syscall_latency.txt
+run_guest benchmark-syscall/build/syscall.elf | \
+  grep -F "[Syscall Latency]" | tee results/syscall_latency.txt
+exit "${PIPESTATUS[0]}"
@@ -1,17 +1,15 @@
 #!/bin/bash
 
-echo "[*] Measuring TCP throughput..."
-
-# Start server in background
-qemu-system-x86_64 -kernel benchmark-tcp/build/server.elf \
-  -nographic -serial mon:stdio &
+source "$(dirname "$0")/common.sh"
 
-sleep 2
+echo "[*] Measuring TCP throughput..."
 
-# Run client
-qemu-system-x86_64 -kernel benchmark-tcp/build/client.elf \
-  -nographic -serial mon:stdio | \
-  grep "TCP_THROUGHPUT" | tee results/tcp_throughput.txt
+SERVER_LOG=$(mktemp)
+trap 'rm -f "$SERVER_LOG"' EXIT
 
-# Kill background server
-pkill -f server.elf
+# The server powers off once the client disconnects. TCP_RR in the default
+# rr mode, Throughput with tcp.mode=stream
+run_tcp_pair benchmark-tcp/build/server.elf benchmark-tcp/build/client.elf \
+  "$SERVER_LOG" | \
+  grep -E "TCP_RR|\[TCP\] Throughput" | tee results/tcp_throughput.txt
+exit "${PIPESTATUS[0]}"
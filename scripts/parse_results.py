@@ -1,101 +1,188 @@
-import re
+"""
+Parses the logs run_all.sh writes to results/benchmark-<bench>.<profile>.txt
+into parsed_benchmark_results.csv, one row per value and profile.
+"""
+import argparse
 import csv
+import glob
+import os
+import re
+
+parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+parser.add_argument("--profile", help="only parse the logs of this profile")
+args = parser.parse_args()
+
+
+def open_logs(bench):
+    """Yields (profile, file) for every log of a benchmark."""
+    for path in sorted(glob.glob(f"./results/benchmark-{bench}.*.txt")):
+        profile = os.path.basename(path).split(".")[1]
+        if args.profile and profile != args.profile:
+            continue
+        with open(path) as f:
+            yield profile, f
+
+
+def number(value):
+    return float(value) if "." in value else int(value)
+
+
+def fields(text, unit, pattern=r"(\w+)=(\d+)"):
+    """(key, value, unit) of every key=value in text, unit(key, value)."""
+    return [(key, number(value), unit(key, value))
+            for key, value in re.findall(pattern, text)]
+
+
+def boot_phase(m):
+    return [("boot phase", f"{m[1]} ({m[3]} fns)", int(m[2]), "ns")]
+
+
+def tcp_stream(m):
+    return [(f"stream {m[1]}", f"{m[2]} bytes", int(m[3]), "Mbit/s")]
+
+
+def tcp_rr(m):
+    detail = f"{m[2]}/{m[3]} bytes"
+    return [("rr transactions", detail, int(m[1]), "trans/s")] + \
+        [(f"rr rtt {key}", detail, value, unit)
+         for key, value, unit in fields(m[4], lambda k, v: "ns", r"(\S+)=(\d+)")]
+
+
+def lat_hist(m):
+    return [(f"{m[1]} latency", key, value, unit)
+            for key, value, unit in fields(m[2], lambda k, v: "ns", r"(\S+)=(\d+)")]
+
+
+def malloc_class(m):
+    return [("size class", f"{m[1]} bytes ({m[2]} allocs)", int(m[3]), "ops/s")]
+
+
+def syscall_latency(m):
+    return [(m[1], "mean", int(m[2]), "ns")]
+
+
+def bench_timing(m):
+    unit = lambda k, v: "Hz" if k == "freq" else \
+        "ns" if k == "overhead_ns" else "cycles"
+    return [("timing", key, value, unit) for key, value, unit in fields(m[1], unit)]
+
+
+def syscall_path(m):
+    return [(m[1], f"{key} p50", value, unit)
+            for key, value, unit in fields(m[2], lambda k, v: "ns")]
+
+
+def clock_source(m):
+    unit = lambda k, v: "ns" if k in ("avg", "res") else "reads"
+    return [(f"clock {m[1]}", key, value, unit)
+            for key, value, unit in fields(m[2], unit)]
+
+
+def syscall_batch(m):
+    return [(f"batch {m[1]} {m[2]}", f"batch {m[3]}", int(m[4]), "ops/s")]
+
+
+def malloc_path(m):
+    mode = m[1].lower()
+    unit = lambda k, v: "ops/s" if k == "ops" else \
+        "ns" if mode == "calloc" and k != "count" else "allocs"
+    return [(f"{mode} {key}", f"{m[2]} bytes", value, unit)
+            for key, value, unit in fields(m[3], unit)]
+
+
+def malloc_soak(m):
+    unit = lambda k, v: "ops/s" if k == "ops" else "ns"
+    return [(f"soak {key}", f"t={m[1]}s", value, unit)
+            for key, value, unit in fields(m[2], unit)]
+
+
+def malloc_soak_drift(m):
+    return [(f"soak drift {key}", "last vs first interval", float(value), unit)
+            for key, value, unit in fields(m[1], lambda k, v: "%",
+                                           r"(\w+)=([+-][\d.]+)%")]
+
+
+def palloc_order(m):
+    unit = lambda k, v: "ops/s" if k == "ops" else "allocs"
+    return [(f"palloc {key}", f"order {m[1]}", value, unit)
+            for key, value, unit in fields(m[2], unit)]
+
+
+def malloc_trace(m):
+    unit = lambda k, v: "ns" if k.endswith("_ns") else \
+        "bytes" if k == "peak_requested" else "records"
+    return [("trace replay", key, value, unit)
+            for key, value, unit in fields(m[1], unit)]
+
+
+def malloc_frag(m):
+    unit = lambda k, v: "ratio" if "." in v else \
+        "allocs" if k in ("live", "enomem") else "bytes"
+    return [(f"heap {key}", m[1], value, unit)
+            for key, value, unit in fields(m[2], unit, r"(\w+)=([\d.]+)")]
+
 
-log_files = {
-    "boot": "./results/benchmark-boot.txt",
-    "malloc": "./results/benchmark-malloc.txt",
-    "syscall": "./results/benchmark-syscall.txt",
-    "tcp": "./results/benchmark-tcp.txt"
-}
+# (benchmarks, line pattern, rows) - rows(match) returns the
+# (operation, detail, value, unit) rows of one matching line
+PARSERS = [
+    # Per-phase boot timeline (CONFIG_APPBENCHMARKBOOT_TIMELINE)
+    (["boot"], r"BOOT_PHASE: (\S+) (\d+) ns \((\d+) fns\)", boot_phase),
+    # Goodput of the TCP stream mode, server lines if merged in
+    (["tcp"], r"TCP_STREAM: (\w+) bytes=(\d+) ns=\d+ mbps=(\d+)", tcp_stream),
+    # Transaction rate and RTT percentiles of the TCP rr mode
+    (["tcp"], r"TCP_RR: (\d+) trans/s req=(\d+) resp=(\d+) (.*) ns", tcp_rr),
+    # Per-operation latency histograms (bench_hist_print())
+    (["malloc", "syscall", "tcp"], r"LAT_HIST: (\S+) count=\d+ (.*) ns", lat_hist),
+    # Per-size-class throughput of the malloc size modes
+    (["malloc"], r"MALLOC_CLASS: (\d+) count=(\d+) ops=(\d+)", malloc_class),
+    # Mean latency per case of the syscall matrix
+    (["syscall"], r"\[Syscall Latency\] (\w+)\(\): (\d+) ns", syscall_latency),
+    # Counter calibration of the syscall timing harness
+    (["syscall"], r"BENCH_TIMING: (.*)", bench_timing),
+    # Median per entry path of the syscall matrix
+    (["syscall"], r"SYSCALL_PATH: (\w+) (.*)", syscall_path),
+    # Time source summaries of the clocks mode
+    (["syscall"], r"CLOCK_SOURCE: (\w+) (.*)", clock_source),
+    # Batched submission mode
+    (["syscall"], r"SYSCALL_BATCH: (\w+) (\w+) batch=(\d+) ops=(\d+)", syscall_batch),
+    # realloc/calloc/memalign path modes
+    (["malloc"], r"MALLOC_(REALLOC|CALLOC|ALIGN): (\d+) (.*)", malloc_path),
+    # Interval reports and drift summary of the soak mode
+    (["malloc"], r"MALLOC_SOAK: t=(\d+) (.*)", malloc_soak),
+    (["malloc"], r"MALLOC_SOAK_DRIFT: (.*)", malloc_soak_drift),
+    # Per-order results of the page allocator modes
+    (["malloc"], r"PALLOC_ORDER: (\d+) (.*)", palloc_order),
+    # Summary of a replayed allocation trace
+    (["malloc"], r"MALLOC_TRACE: (.*)", malloc_trace),
+    # Heap footprint / fragmentation snapshots
+    (["malloc"], r"MALLOC_FRAG: (\S+) (.*)", malloc_frag),
+]
 
 results = []
 
-# Parse boot log
-with open(log_files["boot"]) as f:
-    start_time = end_time = None
-    for line in f:
-        if "boot benchmark: start" in line:
-            print(f"Start Line: {line.strip()}")
-            start_time = float(re.search(r"\[(.*?)\]", line).group(1))
-        elif "boot benchmark: end" in line:
-            print(f"End Line: {line.strip()}")
-            end_time = float(re.search(r"\[(.*?)\]", line).group(1))
-    if start_time and end_time:
-        results.append({
-            "benchmark": "boot",
-            "operation": "boot duration",
-            "detail": "system boot time",
-            "value": round(end_time - start_time, 6),
-            "unit": "seconds"
-        })
-
-# Parse malloc log
-with open(log_files["malloc"]) as f:
-    current_detail = ""
-    for line in f:
-        if "Allocating" in line:
-            print(f"Malloc Alloc Line: {line.strip()}")
-            match = re.search(r"Allocating (.*?) blocks of (.*?) bytes", line)
-            if match:
-                current_detail = f"{match.group(1)} blocks, {match.group(2)} bytes each"
-        elif "Time taken" in line:
-            print(f"Malloc Time Line: {line.strip()}")
-            time = float(re.search(r"Time taken: (.*?) seconds", line).group(1))
-            results.append({
-                "benchmark": "malloc",
-                "operation": "memory allocation",
-                "detail": current_detail,
-                "value": time,
-                "unit": "seconds"
-            })
-
-# Parse syscall log
-with open(log_files["syscall"]) as f:
-    current_detail = ""
-    for line in f:
-        if "Invoking" in line:
-            print(f"Syscall Invoking Line: {line.strip()}")
-            current_detail = re.search(r"Invoking (.*?) \d+", line).group(1)
-        elif "Time taken" in line:
-            print(f"Syscall Time Line: {line.strip()}")
-            time = float(re.search(r"Time taken: (.*?) seconds", line).group(1))
-            results.append({
-                "benchmark": "syscall",
-                "operation": "syscall",
-                "detail": current_detail,
-                "value": time,
-                "unit": "seconds"
-            })
-
-# Parse TCP log
-with open(log_files["tcp"]) as f:
-    for line in f:
-        if "Sent" in line:
-            print(f"TCP Sent Line: {line.strip()}")
-            match = re.search(r"Sent (.*?) bytes in (.*?) seconds", line)
-            if match:
-                results.append({
-                    "benchmark": "tcp",
-                    "operation": "tcp send",
-                    "detail": f"{match.group(1)} bytes",
-                    "value": float(match.group(2)),
-                    "unit": "seconds"
-                })
-        elif "Received" in line:
-            print(f"TCP Received Line: {line.strip()}")
-            match = re.search(r"Received (.*?) bytes in (.*?) seconds", line)
-            if match:
-                results.append({
-                    "benchmark": "tcp",
-                    "operation": "tcp receive",
-                    "detail": f"{match.group(1)} bytes",
-                    "value": float(match.group(2)),
-                    "unit": "seconds"
-                })
+# Every log is read once, each line is tried against its benchmark's parsers
+for bench in ["boot", "malloc", "syscall", "tcp"]:
+    parsers = [(re.compile(pattern), rows)
+               for benches, pattern, rows in PARSERS if bench in benches]
+    for profile, f in open_logs(bench):
+        for line in f:
+            for pattern, rows in parsers:
+                match = pattern.search(line)
+                if not match:
+                    continue
+                for operation, detail, value, unit in rows(match):
+                    results.append({
+                        "benchmark": bench,
+                        "profile": profile,
+                        "operation": operation,
+                        "detail": detail,
+                        "value": value,
+                        "unit": unit
+                    })
 
 # Write to CSV
 with open("parsed_benchmark_results.csv", "w", newline="") as csvfile:
-    fieldnames = ["benchmark", "operation", "detail", "value", "unit"]
+    fieldnames = ["benchmark", "profile", "operation", "detail", "value", "unit"]
     writer = csv.DictWriter(csvfile, fieldnames=fieldnames)
     writer.writeheader()
     writer.writerows(results)
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+"""
+Build profiles shared by all benchmarks.
+
+Merges profiles/<profile>.yaml (release, debug, trace, alloc/<backend>, ...)
+into the unikraft kconfig block of <bench>/kraft.yaml and writes the result
+next to it as <bench>/.kraft.<profile>.yaml, ready for `kraft build -K`.
+Profile values override the base ones, so the same app is built with and
+without debug output. Several profiles can be stacked, later ones win; the
+output is then named after all of them (e.g. .kraft.release-alloc-tlsf.yaml).
+A profile may also carry a `libraries:` block for external libraries, which
+is appended to the Kraftfile's own. Prints the path of the generated
+Kraftfile.
+"""
+import os
+import re
+import sys
+
+ROOT_DIR = os.path.join(os.path.dirname(os.path.realpath(__file__)), "..")
+KCONFIG_RE = re.compile(r"^\s*(CONFIG_\w+):\s*(\S+)")
+
+
+def read_profile(name, options, libraries):
+    """Adds the kconfig options and `libraries:` lines of a profile."""
+    path = os.path.join(ROOT_DIR, "profiles", f"{name}.yaml")
+    in_libraries = False
+    with open(path) as f:
+        for line in f:
+            if line.startswith("libraries:"):
+                in_libraries = True
+            elif in_libraries and line[:1].isspace():
+                libraries.append(line)
+            else:
+                in_libraries = False
+                match = KCONFIG_RE.match(line)
+                if match:
+                    options[match.group(1)] = match.group(2)
+
+
+def merge(kraftfile, options, libraries=()):
+    """
+    Returns the Kraftfile lines with `options` merged into unikraft.kconfig
+    and `libraries` appended to the libraries block.
+    """
+    out = []
+    section = None
+    in_kconfig = False
+    pending = dict(options)
+    pending_libs = list(libraries)
+
+    def flush():
+        for key, value in pending.items():
+            out.append(f"    {key}: {value}\n")
+        pending.clear()
+
+    for line in kraftfile:
+        if line and not line[0].isspace():
+            if in_kconfig:
+                flush()
+            if section == "libraries":
+                out.extend(pending_libs)
+                pending_libs.clear()
+            elif line.startswith("targets:") and pending_libs:
+                out.append("libraries:\n")
+                out.extend(pending_libs)
+                pending_libs.clear()
+            section = line.split(":")[0]
+            in_kconfig = False
+        elif section == "unikraft" and line.strip() == "kconfig:":
+            in_kconfig = True
+            out.append(line)
+            continue
+        elif in_kconfig:
+            match = KCONFIG_RE.match(line)
+            if match and match.group(1) in pending:
+                out.append(f"    {match.group(1)}: {pending.pop(match.group(1))}\n")
+                continue
+        out.append(line)
+    if in_kconfig:
+        flush()
+    if pending_libs:
+        if section != "libraries":
+            out.append("libraries:\n")
+        out.extend(pending_libs)
+    if pending:
+        raise SystemExit("kraft.yaml has no unikraft.kconfig block")
+    return out
+
+
+def main():
+    if len(sys.argv) < 3:
+        raise SystemExit(f"usage: {sys.argv[0]} <benchmark-dir> <profile>...")
+    bench, profiles = sys.argv[1], sys.argv[2:]
+
+    options = {}
+    libraries = []
+    for profile in profiles:
+        read_profile(profile, options, libraries)
+    with open(os.path.join(bench, "kraft.yaml")) as f:
+        lines = merge(f.readlines(), options, libraries)
+
+    name = "-".join(p.replace("/", "-") for p in profiles)
+    path = os.path.join(bench, f".kraft.{name}.yaml")
+    with open(path, "w") as f:
+        f.writelines(lines)
+    print(path)
+
+
+if __name__ == "__main__":
+    main()
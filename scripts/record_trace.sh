@@ -0,0 +1,40 @@
+#!/bin/bash
+# record_trace.sh <trace> -- <command> [args...]
+#
+# Records every malloc/free/calloc/realloc/memalign of a host program
+# (glibc, dynamically linked) into <trace>, for replay inside the unikernel
+# with malloc.mode=replay:
+#
+#   ./scripts/record_trace.sh results/redis.trace -- redis-benchmark -n 1000
+#   qemu-system-x86_64 -kernel benchmark-malloc/build/malloc.elf \
+#     -initrd results/redis.trace -append "malloc.mode=replay --" ...
+
+set -e
+
+if (( $# < 3 )) || [[ "$2" != "--" ]]; then
+  echo "usage: $0 <trace> -- <command> [args...]"
+  exit 2
+fi
+
+TRACE=$1
+shift 2
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+LIB=$ROOT/scripts/build/alloc_trace.so
+
+# Rebuilt whenever the recorder or the trace format changes
+if [[ ! -f "$LIB" || "$ROOT/scripts/alloc_trace.c" -nt "$LIB" ||
+      "$ROOT/common/include/bench/alloc_trace.h" -nt "$LIB" ]]; then
+  mkdir -p "$(dirname "$LIB")"
+  ${CC:-cc} -O2 -shared -fPIC -I"$ROOT/common/include" \
+    -o "$LIB" "$ROOT/scripts/alloc_trace.c" -lpthread
+fi
+
+set +e
+ALLOC_TRACE_OUT=$TRACE LD_PRELOAD=$LIB${LD_PRELOAD:+:$LD_PRELOAD} "$@"
+STATUS=$?
+
+if [[ -s "$TRACE" ]]; then
+  echo "[*] Trace written to $TRACE ($(stat -c %s "$TRACE") bytes)"
+fi
+exit "$STATUS"
@@ -4,21 +4,97 @@
 ROOT_DIR=$(dirname "$(realpath "$0")")/..
 cd "$ROOT_DIR" || exit
 
+source scripts/common.sh
+
 # Ensure results directory exists
 mkdir -p results
 
 # Array of benchmarks
 BENCHMARKS=("benchmark-syscall" "benchmark-malloc" "benchmark-tcp" "benchmark-boot")
 
-# Run each benchmark
+# Build profiles (see profiles/), each benchmark is built and run per profile
+read -r -a PROFILES <<< "${PROFILES:-release debug}"
+
+# build <bench> <image> <profile>...
+# Builds the benchmark with the stacked profiles and copies the image to
+# <bench>/build/<image>.elf before the next build replaces it.
+build() {
+  local bench=$1 image=$2 kraftfile
+  shift 2
+
+  echo "🛠 Building $bench ($*)..."
+  kraftfile=$(python3 scripts/profile.py "$bench" "$@") || exit 1
+  (cd "$bench" && kraft build -K "$(basename "$kraftfile")") || \
+    { echo "❌ Build failed for $bench ($*)"; exit 1; }
+  mkdir -p "$bench/build"
+  cp "$bench/.unikraft/build/${bench}_qemu-x86_64" "$bench/build/$image.elf"
+}
+
+# Build everything first so that the runs can overlap
+RUNS=()
 for bench in "${BENCHMARKS[@]}"; do
-  echo "🛠 Building and running $bench..."
-  cd "$bench" || exit 1
-  kraft build || { echo "❌ Build failed for $bench"; exit 1; }
+  for profile in "${PROFILES[@]}"; do
+    if [[ "$bench" == benchmark-tcp ]]; then
+      # One image per role, see profiles/tcp/
+      build "$bench" "$profile.server" "$profile" tcp/server
+      build "$bench" "$profile.client" "$profile" tcp/client
+    else
+      build "$bench" "$profile" "$profile"
+    fi
+    RUNS+=("$bench:$profile")
+  done
+done
+
+# run <bench> <profile> <index>
+# Boots the profile's image through run_guest, so the result code that
+# bench_finish() passes to isa-debug-exit becomes the exit status. TCP runs
+# a server and a client, the server's console goes to its own log.
+run() {
+  local bench=$1 profile=$2
 
+  if [[ "$bench" == benchmark-tcp ]]; then
+    TCP_LINK=127.0.0.1:$((12400 + $3)) run_tcp_pair \
+      "$bench/build/$profile.server.elf" "$bench/build/$profile.client.elf" \
+      "results/$bench.$profile.server.txt"
+  else
+    run_guest "$bench/build/$profile.elf"
+  fi
+}
+
+# Every guest powers itself off through bench_finish(), so runs complete on
+# their own. Set PARALLEL=1 to run them concurrently.
+PIDS=()
+for run in "${RUNS[@]}"; do
+  bench=${run%:*}
+  profile=${run#*:}
+  echo "🚀 Running $bench ($profile)..."
   # Run and log output to results/
-  kraft run > "../results/${bench}.txt" 2>&1
-  cd "$ROOT_DIR" || exit
+  run "$bench" "$profile" "${#PIDS[@]}" > "results/${bench}.${profile}.txt" 2>&1 &
+  PIDS+=($!)
+  if [ -z "$PARALLEL" ]; then
+    wait "${PIDS[-1]}"
+    STATUS[${#PIDS[@]}-1]=$?
+  fi
+done
+
+FAILED=0
+for i in "${!PIDS[@]}"; do
+  if [ -n "$PARALLEL" ]; then
+    wait "${PIDS[$i]}"
+    STATUS[$i]=$?
+  fi
+  (( STATUS[i] == 0 )) || { echo "❌ ${RUNS[$i]} failed"; FAILED=1; }
+done
+
+# Report the profiles side by side, including how much the console was used
+for run in "${RUNS[@]}"; do
+  bench=${run%:*}
+  profile=${run#*:}
+  log="results/${bench}.${profile}.txt"
+  printf '%-20s %-8s %5s console lines | %s\n' "$bench" "$profile" \
+    "$(wc -l < "$log")" \
+    "$(grep -h -m1 -E "BOOT_TIME|MALLOC_OPS|Syscall Latency|TCP_RR|Throughput" "$log")"
 done
 
-echo "✅ All benchmarks completed."
+[ "$FAILED" -eq 0 ] && echo "✅ All benchmarks completed."
+exit "$FAILED"
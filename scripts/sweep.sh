@@ -0,0 +1,79 @@
+#!/bin/bash
+# sweep.sh <malloc|syscall|tcp> <param> <value>...
+#
+# Boots one built image once per value with "<bench>.<param>=<value>" on the
+# kernel command line and collects the headline result of every run in
+# results/sweep_<bench>_<param>.csv, e.g.
+#
+#   ./scripts/sweep.sh malloc size 16 64 256 1024 4096
+#   ./scripts/sweep.sh tcp size 64 1024 4096 65536
+#
+# Extra guest parameters for every run can be given in SWEEP_ARGS, e.g.
+# SWEEP_ARGS="malloc.allocs=10000".
+
+source "$(dirname "$0")/common.sh"
+
+if (( $# < 3 )); then
+  echo "usage: $0 <malloc|syscall|tcp> <param> <value>..."
+  exit 2
+fi
+
+BENCH=$1
+PARAM=$2
+shift 2
+
+case "$BENCH" in
+  malloc)
+    KERNEL=benchmark-malloc/build/malloc.elf
+    PATTERN="MALLOC_OPS"
+    ;;
+  syscall)
+    KERNEL=benchmark-syscall/build/syscall.elf
+    PATTERN="getpid\(\)"
+    ;;
+  tcp)
+    KERNEL=benchmark-tcp/build/client.elf
+    SERVER_KERNEL=benchmark-tcp/build/server.elf
+    # TCP_RR in the default rr mode, Throughput with tcp.mode=stream
+    PATTERN="TCP_RR|Throughput"
+    ;;
+  *)
+    echo "[!] Unknown benchmark: $BENCH"
+    exit 2
+    ;;
+esac
+
+mkdir -p results
+CSV=results/sweep_${BENCH}_${PARAM}.csv
+LOG=$(mktemp)
+SERVER_LOG=$(mktemp)
+trap 'rm -f "$LOG" "$SERVER_LOG"' EXIT
+
+echo "$PARAM,result" > "$CSV"
+FAILED=0
+
+for value in "$@"; do
+  ARGS="$BENCH.$PARAM=$value $SWEEP_ARGS --"
+  echo "[*] $BENCH: $ARGS"
+
+  if [[ -n "$SERVER_KERNEL" ]]; then
+    # The server shares the tcp.* parameters, so its buffer follows tcp.size
+    run_tcp_pair "$SERVER_KERNEL" "$KERNEL" "$SERVER_LOG" "$ARGS" > "$LOG"
+  else
+    run_guest "$KERNEL" -append "$ARGS" > "$LOG"
+  fi
+  RESULT=$?
+
+  LINE=$(grep -m1 -E "$PATTERN" "$LOG")
+  if (( RESULT != 0 )) || [[ -z "$LINE" ]]; then
+    echo "❌ $PARAM=$value failed"
+    FAILED=1
+    continue
+  fi
+  echo "$LINE"
+  # First number after the ':' is the headline value of every benchmark
+  echo "$value,$(sed -E 's/^[^:]*: *([0-9.]+).*/\1/' <<< "$LINE")" >> "$CSV"
+done
+
+echo "✅ Sweep saved to '$CSV'"
+exit "$FAILED"